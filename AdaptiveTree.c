@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "AdaptiveTree.h"
+
+// 127 characters and the NYT leaf
+#define ASCII_SIZE 127
+#define MAX_LEAVES (ASCII_SIZE + 1)
+#define MAX_NODES (2 * MAX_LEAVES - 1)
+#define ROOT (MAX_NODES - 1)
+#define NONE UINT16_MAX
+
+static const size_t LITERAL_BITS = 7;
+static const unsigned END_LITERAL = ASCII_SIZE;
+
+// Nodes are indexed by their number: weights never decrease with the index,
+// and the two children of a node are next to each other.
+typedef struct adaptive_node_t {
+    uint16_t parent;
+    uint16_t left;  // NONE for a leaf
+    uint16_t right;
+    int16_t symbol; // The character of a leaf, -1 otherwise
+    size_t weight;
+} AdaptiveNode;
+
+struct adaptive_tree_t {
+    AdaptiveNode nodes[MAX_NODES];
+    uint16_t leaves[ASCII_SIZE]; // Node of each character, NONE if unseen
+    uint16_t nyt;
+};
+
+AdaptiveTree* atCreate(void) {
+    AdaptiveTree* tree = malloc(sizeof(AdaptiveTree));
+    if (!tree) {
+        return NULL;
+    }
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        tree->leaves[c] = NONE;
+    }
+    AdaptiveNode* root = &tree->nodes[ROOT];
+    root->parent = root->left = root->right = NONE;
+    root->symbol = -1;
+    root->weight = 0;
+    tree->nyt = ROOT;
+    return tree;
+}
+
+void atFree(AdaptiveTree* tree) {
+    free(tree);
+}
+
+/**
+ * Repairs the links pointing to a node which was just moved.
+ * @param tree The tree
+ * @param i The new index of the node
+ */
+static void relink(AdaptiveTree* tree, uint16_t i) {
+    AdaptiveNode* node = &tree->nodes[i];
+    if (node->left != NONE) {
+        tree->nodes[node->left].parent = i;
+        tree->nodes[node->right].parent = i;
+    } else if (node->symbol >= 0) {
+        tree->leaves[node->symbol] = i;
+    } else {
+        tree->nyt = i;
+    }
+}
+
+/**
+ * Exchanges the subtrees rooted at two nodes, none being an ancestor of the
+ * other. The nodes keep their numbers and their parents.
+ * @param tree The tree
+ * @param i The number of the first node
+ * @param j The number of the second node
+ */
+static void swap(AdaptiveTree* tree, uint16_t i, uint16_t j) {
+    AdaptiveNode tmp = tree->nodes[i];
+    tree->nodes[i] = tree->nodes[j];
+    tree->nodes[j] = tmp;
+    tree->nodes[j].parent = tree->nodes[i].parent;
+    tree->nodes[i].parent = tmp.parent;
+    relink(tree, i);
+    relink(tree, j);
+}
+
+/**
+ * Counts one more occurrence of a character, adding it to the tree if it is
+ * seen for the first time, and restores the sibling property.
+ * @param tree The tree
+ * @param symbol The character
+ */
+static void update(AdaptiveTree* tree, unsigned symbol) {
+    AdaptiveNode* nodes = tree->nodes;
+    uint16_t q = tree->leaves[symbol];
+    if (q == NONE) {
+        // The NYT leaf gets the NYT and the new character as children
+        uint16_t old = tree->nyt;
+        uint16_t leaf = old - 1, nyt = old - 2;
+        nodes[old].left = nyt;
+        nodes[old].right = leaf;
+        nodes[leaf].parent = nodes[nyt].parent = old;
+        nodes[leaf].left = nodes[leaf].right = NONE;
+        nodes[nyt].left = nodes[nyt].right = NONE;
+        nodes[leaf].symbol = (int16_t) symbol;
+        nodes[nyt].symbol = -1;
+        nodes[leaf].weight = nodes[nyt].weight = 0;
+        tree->leaves[symbol] = leaf;
+        tree->nyt = nyt;
+        q = leaf;
+    }
+
+    while (q != NONE) {
+        // Highest numbered node of the same weight
+        uint16_t leader = q;
+        while (leader < ROOT && nodes[leader + 1].weight == nodes[q].weight) {
+            leader++;
+        }
+        if (leader != q && leader != nodes[q].parent) {
+            swap(tree, q, leader);
+            q = leader;
+        }
+        nodes[q].weight++;
+        q = nodes[q].parent;
+    }
+}
+
+/**
+ * Appends the code of a node, from the root down to the node.
+ * @param tree The tree
+ * @param node The number of the node
+ * @param writer The bit writer
+ * @return true on success, false on error
+ */
+static bool write_path(const AdaptiveTree* tree, uint16_t node,
+                       BitWriter* writer) {
+    unsigned char path[MAX_LEAVES];
+    size_t depth = 0;
+    for (; node != ROOT; node = tree->nodes[node].parent) {
+        path[depth++] = tree->nodes[tree->nodes[node].parent].right == node;
+    }
+
+    while (depth > 0) {
+        size_t n = depth < BISE_MAX_WRITE_BITS ? depth : BISE_MAX_WRITE_BITS;
+        uint64_t bits = 0;
+        for (size_t i = 0; i < n; i++) {
+            bits = (bits << 1) | path[--depth];
+        }
+        if (!biseWriteBits(writer, bits, n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool atEncode(AdaptiveTree* tree, const char* chars, size_t n_chars,
+              BitWriter* writer) {
+    for (size_t i = 0; i < n_chars; i++) {
+        unsigned char c = (unsigned char) chars[i];
+        if (c >= ASCII_SIZE) {
+            continue;
+        }
+        uint16_t leaf = tree->leaves[c];
+        if (leaf != NONE) {
+            if (!write_path(tree, leaf, writer)) {
+                return false;
+            }
+        } else if (!write_path(tree, tree->nyt, writer) ||
+                   !biseWriteBits(writer, c, LITERAL_BITS)) {
+            return false;
+        }
+        update(tree, c);
+    }
+    return true;
+}
+
+bool atEncodeEnd(AdaptiveTree* tree, BitWriter* writer) {
+    return write_path(tree, tree->nyt, writer) &&
+           biseWriteBits(writer, END_LITERAL, LITERAL_BITS);
+}
+
+bool atDecode(AdaptiveTree* tree, BitReader* reader, size_t limit, char* dest,
+              size_t capacity, size_t* n_decoded, bool* reachedEnd) {
+    const AdaptiveNode* nodes = tree->nodes;
+    size_t n = 0;
+    *reachedEnd = false;
+
+    while (n < capacity && biseReaderTell(reader) < limit) {
+        uint16_t node = ROOT;
+        while (nodes[node].left != NONE) {
+            uint64_t bits = biseReaderPeek(reader, BISE_MAX_PEEK_BITS);
+            size_t used = 0;
+            while (used < BISE_MAX_PEEK_BITS && nodes[node].left != NONE) {
+                node = (bits >> (BISE_MAX_PEEK_BITS - 1 - used)) & 1
+                       ? nodes[node].right : nodes[node].left;
+                used++;
+            }
+            biseReaderConsume(reader, used);
+        }
+
+        unsigned symbol;
+        if (node == tree->nyt) {
+            symbol = (unsigned) biseReaderPeek(reader, LITERAL_BITS);
+            biseReaderConsume(reader, LITERAL_BITS);
+        } else {
+            symbol = (unsigned) nodes[node].symbol;
+        }
+        if (biseReaderTell(reader) > reader->n_bits) {
+            *n_decoded = n;
+            return false;
+        }
+        if (symbol == END_LITERAL) {
+            *reachedEnd = true;
+            break;
+        }
+        // A literal of a character already seen cannot be decoded again
+        if (node == tree->nyt && tree->leaves[symbol] != NONE) {
+            *n_decoded = n;
+            return false;
+        }
+
+        dest[n++] = (char) symbol;
+        update(tree, symbol);
+    }
+
+    *n_decoded = n;
+    return true;
+}
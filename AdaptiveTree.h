@@ -0,0 +1,99 @@
+/* ========================================================================= *
+ * Adaptive coding tree interface.
+ *
+ * NOTE
+ * - One-pass adaptive Huffman coding (FGK): the encoder and the decoder
+ *   start from the same tree, holding a single "not yet transmitted" (NYT)
+ *   leaf, and update it in the same way after each character. No
+ *   frequencies are needed in advance and the text is read only once.
+ * - A character seen for the first time is encoded as the code of the NYT
+ *   leaf followed by the character on 7 bits. The NYT code followed by 127,
+ *   which is not a character, marks the end of the text.
+ * - Nodes are stored by number, in increasing order of weight (sibling
+ *   property), so that swapping two subtrees is constant time.
+ * - Going left correspond to `0`, going right correspond to `1`.
+ * ========================================================================= */
+
+#ifndef _ADAPTIVE_TREE_H_
+#define _ADAPTIVE_TREE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "BinarySequence.h"
+
+/* Maximum length of a code, end of text included */
+#define AT_MAX_CODE_LENGTH 134
+
+/* Opaque structure */
+typedef struct adaptive_tree_t AdaptiveTree;
+
+/* ------------------------------------------------------------------------- *
+ * Build the initial adaptive tree, holding only the NYT leaf.
+ *
+ * NOTE
+ * The returned structure should be cleaned with `atFree` after usage.
+ *
+ * RETURN
+ * tree         The created tree, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+AdaptiveTree* atCreate(void);
+
+/* ------------------------------------------------------------------------- *
+ * Free an adaptive tree.
+ *
+ * PARAMETERS
+ * tree         The tree to free
+ * ------------------------------------------------------------------------- */
+void atFree(AdaptiveTree* tree);
+
+/* ------------------------------------------------------------------------- *
+ * Encode a chunk of an ascii encoded text, updating the tree after each
+ * character. Non-ascii characters are filtered out.
+ *
+ * PARAMETERS
+ * tree         The tree, as left by the previous chunks
+ * chars        The characters to encode
+ * n_chars      The number of characters to encode
+ * writer       The bit writer where to append the encoded characters
+ *
+ * RETURN
+ * success      True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool atEncode(AdaptiveTree* tree, const char* chars, size_t n_chars,
+              BitWriter* writer);
+
+/* ------------------------------------------------------------------------- *
+ * Write the end of the text.
+ *
+ * PARAMETERS
+ * tree         The tree, as left by the last chunk
+ * writer       The bit writer where to append the end of the text
+ *
+ * RETURN
+ * success      True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool atEncodeEnd(AdaptiveTree* tree, BitWriter* writer);
+
+/* ------------------------------------------------------------------------- *
+ * Decode the characters whose code starts before the bit `limit`, updating
+ * the tree after each of them, stopping early when `capacity` characters
+ * were decoded or when the end of the text is reached.
+ *
+ * PARAMETERS
+ * tree         The tree, as left by the previous calls
+ * reader       A bit reader positioned at the start of a code
+ * limit        The index of the bit from which no code is decoded
+ * dest         An array where to write the decoded characters
+ * capacity     The size of dest
+ * n_decoded    Set to the number of decoded characters
+ * reachedEnd   Set to true if the end of the text was reached
+ *
+ * RETURN
+ * success      True on success, false if a code goes beyond the end of the
+ *              input or the input is not valid
+ * ------------------------------------------------------------------------- */
+bool atDecode(AdaptiveTree* tree, BitReader* reader, size_t limit, char* dest,
+              size_t capacity, size_t* n_decoded, bool* reachedEnd);
+
+#endif // _ADAPTIVE_TREE_H_
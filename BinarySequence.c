@@ -95,11 +95,10 @@ bool biseAddByte(BinarySequence* bs, unsigned char byte) {
 }
 
 bool biseAddSequence(BinarySequence* dest, const BinarySequence* source) {
-    bool success = true;
-    for(size_t i = 0; i < biseGetNumberOfBits(source); ++i) {
-        success &= biseAddBit(dest, biseGetBit(source, i));
-    }
-    return success;
+    BitWriter writer;
+    biseWriterInit(&writer, dest);
+    bool success = biseWriteSequence(&writer, source);
+    return biseWriterFlush(&writer) && success;
 }
 
 Binary biseRemoveBit(BinarySequence* bs) {
@@ -118,6 +117,28 @@ Binary biseGetBit(const BinarySequence* bs, size_t index) {
     return getBit(bs->bits[index / BYTE_SIZE], index);
 }
 
+uint64_t biseGetBits(const BinarySequence* bs, size_t index, size_t n) {
+    if (n == 0 || index >= bs->n_bits) {
+        return 0;
+    }
+    size_t byte_index = index / BYTE_SIZE;
+    size_t n_used_bytes = (bs->n_bits + BYTE_SIZE - 1) / BYTE_SIZE;
+    uint64_t window = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        window <<= BYTE_SIZE;
+        if (byte_index + i < n_used_bytes) {
+            window |= bs->bits[byte_index + i];
+        }
+    }
+    // Drop the bits preceding `index`, then keep the `n` leading ones
+    uint64_t bits = (window << (index % BYTE_SIZE)) >> (64 - n);
+    if (index + n > bs->n_bits) { // clear whatever lies past the last bit
+        size_t n_outside = index + n - bs->n_bits;
+        bits = (bits >> n_outside) << n_outside;
+    }
+    return bits;
+}
+
 size_t biseGetNumberOfBits(const BinarySequence* bs) {
     return bs->n_bits;
 }
@@ -163,3 +184,128 @@ unsigned char biseGetByte(const BinarySequence* bs, size_t index, Binary padding
 size_t biseGetNumberOfBytes(const BinarySequence* bs) {
     return (bs->n_bits / BYTE_SIZE) + 1;
 }
+
+bool biseWriteToFile(const BinarySequence* bs, FILE* file) {
+    size_t n_whole = bs->n_bits / BYTE_SIZE;
+    if (fwrite(bs->bits, sizeof(BITS), n_whole, file) != n_whole) {
+        return false;
+    }
+    if (bs->n_bits % BYTE_SIZE == 0) {
+        return true;
+    }
+    BITS last = biseGetByte(bs, n_whole, ZERO);
+    return fwrite(&last, sizeof(BITS), 1, file) == 1;
+}
+
+void biseWriterInit(BitWriter* writer, BinarySequence* bs) {
+    writer->bs = bs;
+    writer->buffer = 0;
+    writer->n_buffered = bs->n_bits % BYTE_SIZE;
+
+    // Take the incomplete last byte back so that the sequence stays aligned
+    if (writer->n_buffered > 0) {
+        bs->n_bits -= writer->n_buffered;
+        BITS last = bs->bits[bs->n_bits / BYTE_SIZE];
+        last >>= BYTE_SIZE - writer->n_buffered;
+        writer->buffer = ((uint64_t) last) << (64 - writer->n_buffered);
+    }
+}
+
+bool biseWriterDrain(BitWriter* writer) {
+    BinarySequence* bs = writer->bs;
+    size_t byte_index = bs->n_bits / BYTE_SIZE;
+
+    // Always keep room for a whole word, growing geometrically
+    if (byte_index + sizeof(uint64_t) > bs->n_bytes) {
+        size_t new_size = 2 * bs->n_bytes;
+        if (new_size < byte_index + sizeof(uint64_t)) {
+            new_size = byte_index + sizeof(uint64_t);
+        }
+        if (!increaseSize(bs, new_size)) {
+            return false;
+        }
+    }
+
+    // Store the whole word, only the complete bytes are accounted for
+    uint64_t buffer = writer->buffer;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        bs->bits[byte_index + i] = (BITS) (buffer >> 56);
+        buffer <<= BYTE_SIZE;
+    }
+
+    size_t n_complete = writer->n_buffered - writer->n_buffered % BYTE_SIZE;
+    bs->n_bits += n_complete;
+    writer->buffer = n_complete == 64 ? 0 : writer->buffer << n_complete;
+    writer->n_buffered -= n_complete;
+    return true;
+}
+
+bool biseWriteSequence(BitWriter* writer, const BinarySequence* source) {
+    size_t n_bits = biseGetNumberOfBits(source);
+    for (size_t i = 0; i < n_bits; i += BISE_MAX_WRITE_BITS) {
+        size_t n = n_bits - i < BISE_MAX_WRITE_BITS ?
+                   n_bits - i : BISE_MAX_WRITE_BITS;
+        if (!biseWriteBits(writer, biseGetBits(source, i, n), n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool biseWriterEmit(BitWriter* writer, FILE* file) {
+    if (!biseWriterDrain(writer)) {
+        return false;
+    }
+    BinarySequence* bs = writer->bs;
+    size_t n_bytes = bs->n_bits / BYTE_SIZE;
+    bs->n_bits = 0;
+    return fwrite(bs->bits, sizeof(BITS), n_bytes, file) == n_bytes;
+}
+
+void biseReaderInit(BitReader* reader, const BinarySequence* bs, size_t start) {
+    biseReaderInitBuffer(reader, bs->bits, bs->n_bits, start);
+}
+
+void biseReaderInitBuffer(BitReader* reader, const unsigned char* bytes,
+                          size_t n_bits, size_t start) {
+    reader->bytes = bytes;
+    reader->n_bits = n_bits;
+    reader->position = start;
+    reader->window = 0;
+    reader->n_window = 0;
+}
+
+void biseReaderRefillTail(BitReader* reader) {
+    uint64_t window = 0;
+    if (reader->position < reader->n_bits) {
+        size_t byte_index = reader->position / BYTE_SIZE;
+        size_t n_used_bytes = (reader->n_bits + BYTE_SIZE - 1) / BYTE_SIZE;
+        for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+            window <<= BYTE_SIZE;
+            if (byte_index + i < n_used_bytes) {
+                window |= reader->bytes[byte_index + i];
+            }
+        }
+        window <<= reader->position % BYTE_SIZE;
+
+        // Clear whatever lies past the last bit
+        size_t n_left = reader->n_bits - reader->position;
+        if (n_left < 64) {
+            window &= ~(~((uint64_t) 0) >> n_left);
+        }
+    }
+    // Zeros past the end can be read indefinitely
+    reader->window = window;
+    reader->n_window = 64;
+}
+
+bool biseWriterFlush(BitWriter* writer) {
+    if (!biseWriterDrain(writer)) {
+        return false;
+    }
+    // Remaining incomplete byte, already stored by the drain
+    writer->bs->n_bits += writer->n_buffered;
+    writer->buffer = 0;
+    writer->n_buffered = 0;
+    return true;
+}
@@ -6,7 +6,9 @@
 #define BINARY_SEQUENCE_H_DEFINED
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct binary_sequence_t BinarySequence;
 
@@ -81,6 +83,21 @@ Binary biseRemoveBit(BinarySequence* bs);
   * ------------------------------------------------------------------------- */
 Binary biseGetBit(const BinarySequence* bs, size_t index);
 
+/* ------------------------------------------------------------------------- *
+ * Get `n` consecutive bits of the sequence starting at the given index, the
+ * first bit being the most significant one of the result. Bits past the end
+ * of the sequence are read as zeros.
+ *
+ * PARAMETERS
+ * bs      A valid pointer to the binary sequence
+ * index   Index of the first bit to read
+ * n       The number of bits to read, should be in [0, 57]
+ *
+ * RETURN
+ * bits    The requested bits, right-aligned
+  * ------------------------------------------------------------------------- */
+uint64_t biseGetBits(const BinarySequence* bs, size_t index, size_t n);
+
 /* ------------------------------------------------------------------------- *
  * Return the number of bits in the binary sequence.
  *
@@ -121,6 +138,19 @@ unsigned char biseGetByte(const BinarySequence* bs, size_t index, Binary padding
  * ------------------------------------------------------------------------- */
 size_t biseGetNumberOfBytes(const BinarySequence* bs);
 
+/* ------------------------------------------------------------------------- *
+ * Write the sequence to a file, padding the last byte with zeros. Unlike
+ * `biseGetNumberOfBytes`, no byte is written beyond the last bit.
+ *
+ * PARAMETERS
+ * bs      A valid pointer to a binary sequence
+ * file    The file to write to
+ *
+ * RETURN
+ * success True if the sequence was successfully written, false on error
+ * ------------------------------------------------------------------------- */
+bool biseWriteToFile(const BinarySequence* bs, FILE* file);
+
 /* ------------------------------------------------------------------------- *s
  * Duplicate the given binary sequence into another sequence containing the
  * same bits.
@@ -144,4 +174,224 @@ BinarySequence* biseCopy(const BinarySequence* bs);
   * ------------------------------------------------------------------------- */
 void biseFree(BinarySequence* c);
 
+/* ========================================================================= *
+ * Bit writer
+ *
+ * Appends bits to a binary sequence by accumulating them in a 64-bit word
+ * and flushing whole bytes at once. While the writer is in use, the bits it
+ * buffers are not part of the sequence yet: `biseWriterFlush` must be called
+ * before using the sequence again.
+ * ========================================================================= */
+
+/* Maximum number of bits appended by a single call to `biseWriteBits` */
+#define BISE_MAX_WRITE_BITS 57
+
+typedef struct bit_writer_t {
+    BinarySequence* bs;
+    uint64_t buffer;   // Pending bits, the first one being the most significant
+    size_t n_buffered; // Number of pending bits
+} BitWriter;
+
+/* ------------------------------------------------------------------------- *
+ * Start appending bits to the given sequence.
+ *
+ * PARAMETERS
+ * writer  A valid pointer to the writer to initialize
+ * bs      A valid pointer to the binary sequence to append to
+  * ------------------------------------------------------------------------- */
+void biseWriterInit(BitWriter* writer, BinarySequence* bs);
+
+/* ------------------------------------------------------------------------- *
+ * Move the whole bytes buffered by the writer into its sequence, leaving
+ * less than 8 bits in the buffer. Called by `biseWriteBits` when needed.
+ *
+ * PARAMETERS
+ * writer  A valid pointer to the writer
+ *
+ * RETURN
+ * success True if the bytes were successfully added, false on error
+  * ------------------------------------------------------------------------- */
+bool biseWriterDrain(BitWriter* writer);
+
+/* ------------------------------------------------------------------------- *
+ * Append the `n` least significant bits of `bits` to the sequence, most
+ * significant first.
+ *
+ * PARAMETERS
+ * writer  A valid pointer to the writer
+ * bits    The bits to append, right-aligned. Bits above the `n` least
+ *         significant ones must be zero.
+ * n       The number of bits to append, should be in [0, 57]
+ *
+ * RETURN
+ * success True if the bits were successfully added, false on error
+  * ------------------------------------------------------------------------- */
+static inline bool biseWriteBits(BitWriter* writer, uint64_t bits, size_t n) {
+    if (n == 0) {
+        return true;
+    }
+    if (writer->n_buffered + n > 64 && !biseWriterDrain(writer)) {
+        return false;
+    }
+    writer->buffer |= bits << (64 - writer->n_buffered - n);
+    writer->n_buffered += n;
+    return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Append a whole sequence through the writer.
+ *
+ * PARAMETERS
+ * writer  A valid pointer to the writer
+ * source  A valid pointer to the sequence to append
+ *
+ * RETURN
+ * success True if the bits were successfully added, false on error
+  * ------------------------------------------------------------------------- */
+bool biseWriteSequence(BitWriter* writer, const BinarySequence* source);
+
+/* ------------------------------------------------------------------------- *
+ * Move all the bits buffered by the writer into its sequence. The writer
+ * must be initialized again before appending other bits.
+ *
+ * PARAMETERS
+ * writer  A valid pointer to the writer
+ *
+ * RETURN
+ * success True if the bits were successfully added, false on error
+  * ------------------------------------------------------------------------- */
+bool biseWriterFlush(BitWriter* writer);
+
+/* ------------------------------------------------------------------------- *
+ * Write the whole bytes appended so far to a file and remove them from the
+ * sequence, so that it can be reused for the following bits. The bits which
+ * do not form a whole byte yet are kept in the writer.
+ *
+ * PARAMETERS
+ * writer  A valid pointer to the writer
+ * file    The file to write to
+ *
+ * RETURN
+ * success True if the bytes were successfully written, false on error
+  * ------------------------------------------------------------------------- */
+bool biseWriterEmit(BitWriter* writer, FILE* file);
+
+/* ========================================================================= *
+ * Bit reader
+ *
+ * Reads bits from a binary sequence (or a raw buffer) through a 64-bit
+ * window: up to 57 bits can be looked at with `biseReaderPeek` and then
+ * skipped with `biseReaderConsume`. The window is refilled with a single
+ * word load whenever it holds less bits than requested.
+ * ========================================================================= */
+
+/* Maximum number of bits looked at by a single call to `biseReaderPeek` */
+#define BISE_MAX_PEEK_BITS 57
+
+typedef struct bit_reader_t {
+    const unsigned char* bytes;
+    size_t n_bits;   // Number of bits that can be read
+    size_t position; // Index of the next bit to read
+    uint64_t window; // Bits from `position` on, the first one most significant
+    size_t n_window; // Number of valid bits in the window
+} BitReader;
+
+/* ------------------------------------------------------------------------- *
+ * Start reading a binary sequence from the given index. The sequence must
+ * not be modified while the reader is in use.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader to initialize
+ * bs      A valid pointer to the binary sequence to read
+ * start   Index of the first bit to read
+  * ------------------------------------------------------------------------- */
+void biseReaderInit(BitReader* reader, const BinarySequence* bs, size_t start);
+
+/* ------------------------------------------------------------------------- *
+ * Start reading a raw buffer from the given index. First bits are the most
+ * significant bits of each byte, as in a binary sequence.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader to initialize
+ * bytes   The buffer to read
+ * n_bits  The number of bits that can be read from the buffer
+ * start   Index of the first bit to read
+  * ------------------------------------------------------------------------- */
+void biseReaderInitBuffer(BitReader* reader, const unsigned char* bytes,
+                          size_t n_bits, size_t start);
+
+/* ------------------------------------------------------------------------- *
+ * Refill the window of the reader near the end of its input, reading bits
+ * past the end as zeros. Called by `biseReaderRefill` when needed.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader
+  * ------------------------------------------------------------------------- */
+void biseReaderRefillTail(BitReader* reader);
+
+/* ------------------------------------------------------------------------- *
+ * Refill the window of the reader so that it holds at least 57 bits.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader
+  * ------------------------------------------------------------------------- */
+static inline void biseReaderRefill(BitReader* reader) {
+    size_t byte_index = reader->position / 8;
+    if (byte_index + 8 > reader->n_bits / 8) {
+        biseReaderRefillTail(reader);
+        return;
+    }
+    const unsigned char* p = reader->bytes + byte_index;
+    uint64_t word = ((uint64_t) p[0] << 56) | ((uint64_t) p[1] << 48) |
+                    ((uint64_t) p[2] << 40) | ((uint64_t) p[3] << 32) |
+                    ((uint64_t) p[4] << 24) | ((uint64_t) p[5] << 16) |
+                    ((uint64_t) p[6] << 8) | (uint64_t) p[7];
+    reader->window = word << (reader->position % 8);
+    reader->n_window = 64 - reader->position % 8;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Look at the next `n` bits without consuming them.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader
+ * n       The number of bits to look at, should be in [1, 57]
+ *
+ * RETURN
+ * bits    The next `n` bits, right-aligned. Bits past the end are zeros.
+  * ------------------------------------------------------------------------- */
+static inline uint64_t biseReaderPeek(BitReader* reader, size_t n) {
+    if (reader->n_window < n) {
+        biseReaderRefill(reader);
+    }
+    return reader->window >> (64 - n);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Skip the next `n` bits, which must have been looked at with
+ * `biseReaderPeek`.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader
+ * n       The number of bits to skip
+  * ------------------------------------------------------------------------- */
+static inline void biseReaderConsume(BitReader* reader, size_t n) {
+    reader->position += n;
+    reader->window <<= n;
+    reader->n_window -= n;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Return the index of the next bit to be read.
+ *
+ * PARAMETERS
+ * reader  A valid pointer to the reader
+ *
+ * RETURN
+ * index   The index of the next bit, in the whole sequence
+  * ------------------------------------------------------------------------- */
+static inline size_t biseReaderTell(const BitReader* reader) {
+    return reader->position;
+}
+
 #endif // BINARY_SEQUENCE_H_DEFINED
@@ -0,0 +1,734 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "BlockCoding.h"
+#include "coding.h"
+#include "Checksum.h"
+
+static const size_t ASCII_SIZE = 127;
+static const unsigned char MAGIC[4] = {'H', 'U', 'F', 'B'};
+static const unsigned char VERSION = 1;
+static const size_t HEADER_SIZE = 18;
+static const size_t INDEX_ENTRY_SIZE = 12;
+static const size_t CHECKSUM_SIZE = 4;
+static const size_t LINES_SIZE = 4;
+static const size_t TABLE_ID_SIZE = 1;
+static const size_t JUMP_ENTRY_SIZE = 4;
+// Characters checksummed at once, right after being (de)coded, while they
+// are still in the L1 cache
+static const size_t CHECKED_CHUNK_SIZE = 4096;
+
+typedef void (*BlockTask)(void* context, size_t block);
+
+// A thread of `runBlocks`, running the blocks first, first + step, ...
+typedef struct block_worker_t {
+    BlockTask task;
+    void* context;
+    size_t first;
+    size_t step;
+    size_t n_blocks;
+} BlockWorker;
+
+// Shared by the threads encoding the blocks.
+typedef struct encoding_job_t {
+    const char* chars;
+    size_t n_chars;
+    size_t blockSize;
+    unsigned char flags;
+    // The n_tables codes, 127 lengths and 127 packed codes for each one
+    const unsigned char* lengths;
+    const PackedCode* tables;
+    size_t n_tables;
+
+    BinarySequence** encoded;
+    uint32_t* n_decoded;
+    uint32_t* checksums;
+    uint32_t* n_lines;
+    unsigned char* tableIds;
+    bool* success;
+} EncodingJob;
+
+// Shared by the threads decoding the blocks.
+typedef struct decoding_job_t {
+    const unsigned char* data;
+    DecodingTable* const* tables;
+    const unsigned char* tableIds;
+    const uint64_t* offsets;
+    const uint32_t* n_decoded;
+    const size_t* positions;
+    const uint32_t* checksums;
+    unsigned char flags;
+    // First block decoded, the tasks being numbered from it
+    size_t first;
+
+    char* decoded;
+    bool* success;
+} DecodingJob;
+
+static void* runWorker(void* argument) {
+    BlockWorker* worker = argument;
+    for (size_t b = worker->first; b < worker->n_blocks; b += worker->step) {
+        worker->task(worker->context, b);
+    }
+    return NULL;
+}
+
+/**
+ * Runs `task` on every block, spread over `n_threads` threads. Each thread
+ * gets every n_threads-th block, so that the work done on each block does
+ * not depend on the number of threads.
+ * @param task The function to run on each block
+ * @param context The context given to the task
+ * @param n_blocks The number of blocks
+ * @param n_threads The number of threads
+ */
+static void runBlocks(BlockTask task, void* context, size_t n_blocks,
+                      size_t n_threads) {
+    if (n_threads == 0) {
+        n_threads = 1;
+    }
+    if (n_threads > n_blocks) {
+        n_threads = n_blocks;
+    }
+    if (n_blocks == 0) {
+        return;
+    }
+
+    BlockWorker* workers = malloc(n_threads * sizeof(BlockWorker));
+    pthread_t* threads = malloc(n_threads * sizeof(pthread_t));
+    bool* started = calloc(n_threads, sizeof(bool));
+    if (!workers || !threads || !started) { // Run everything here instead
+        BlockWorker worker = {task, context, 0, 1, n_blocks};
+        runWorker(&worker);
+        free(workers);
+        free(threads);
+        free(started);
+        return;
+    }
+
+    for (size_t t = 0; t < n_threads; t++) {
+        BlockWorker worker = {task, context, t, n_threads, n_blocks};
+        workers[t] = worker;
+        started[t] = pthread_create(&threads[t], NULL, runWorker,
+                                    &workers[t]) == 0;
+    }
+    for (size_t t = 0; t < n_threads; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else { // The thread could not be created, do its share here
+            runWorker(&workers[t]);
+        }
+    }
+
+    free(workers);
+    free(threads);
+    free(started);
+}
+
+/**
+ * Size of an index entry.
+ * @param flags The flags of the file
+ * @return the size in bytes
+ */
+static size_t entrySize(unsigned char flags) {
+    return INDEX_ENTRY_SIZE + (flags & BLOCK_CHECKSUM ? CHECKSUM_SIZE : 0) +
+           (flags & BLOCK_LINES ? LINES_SIZE : 0) +
+           (flags & BLOCK_TABLES ? TABLE_ID_SIZE : 0);
+}
+
+/**
+ * Skips the first lines of a text.
+ * @param chars The text
+ * @param n_chars The number of characters of the text
+ * @param n_lines The number of lines to skip
+ * @return the index of the character following the n_lines-th newline, or
+ * n_chars if there are less newlines
+ */
+static size_t skipLines(const char* chars, size_t n_chars, size_t n_lines) {
+    size_t i = 0;
+    for (; n_lines > 0 && i < n_chars; n_lines--) {
+        const char* newline = memchr(chars + i, '\n', n_chars - i);
+        if (!newline) {
+            return n_chars;
+        }
+        i = (size_t) (newline - chars) + 1;
+    }
+    return i;
+}
+
+/**
+ * Frees the decoding tables of a file.
+ * @param tables The tables, some of which may be NULL, or NULL
+ * @param n_tables The number of tables
+ */
+static void freeTables(DecodingTable** tables, size_t n_tables) {
+    for (size_t t = 0; tables && t < n_tables; t++) {
+        dtFree(tables[t]);
+    }
+    free(tables);
+}
+
+static void putUint(unsigned char* bytes, uint64_t value, size_t n_bytes) {
+    for (size_t i = 0; i < n_bytes; i++) {
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+static uint64_t getUint(const unsigned char* bytes, size_t n_bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < n_bytes; i++) {
+        value |= ((uint64_t) bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Number of characters of each of the DT_STREAMS segments of a block.
+ * @param n_chars The number of characters of the block
+ * @param sizes The array to fill with the size of each segment
+ */
+static void segmentSizes(size_t n_chars, size_t* sizes) {
+    size_t segment = (n_chars + DT_STREAMS - 1) / DT_STREAMS;
+    for (size_t s = 0; s < DT_STREAMS; s++) {
+        size_t first = s * segment < n_chars ? s * segment : n_chars;
+        sizes[s] = n_chars - first < segment ? n_chars - first : segment;
+    }
+}
+
+/**
+ * Encodes characters chunk by chunk, updating the checksum of the ascii ones
+ * after each chunk in the same pass.
+ * @param chars The characters to encode
+ * @param n_chars The number of characters, non-ascii ones included
+ * @param writer The bit writer where to append the codes
+ * @param table The packed coding table
+ * @param crc The checksum to update, or NULL for none
+ * @return true on success, false on error
+ */
+static bool encodeChecked(const char* chars, size_t n_chars,
+                          BitWriter* writer, const PackedCode* table,
+                          uint32_t* crc) {
+    if (!crc) {
+        return encodeChunk(chars, n_chars, writer, table);
+    }
+    for (size_t first = 0; first < n_chars; first += CHECKED_CHUNK_SIZE) {
+        size_t end = n_chars - first < CHECKED_CHUNK_SIZE ?
+                     n_chars : first + CHECKED_CHUNK_SIZE;
+        if (!encodeChunk(chars + first, end - first, writer, table)) {
+            return false;
+        }
+        // The non-ascii characters are skipped, as by the encoder
+        for (size_t i = first; i < end;) {
+            size_t run = i;
+            while (run < end && chars[run] >= 0 && chars[run] < 127) {
+                run++;
+            }
+            *crc = ckCrc32c(*crc, chars + i, run - i);
+            i = run + 1;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decodes characters chunk by chunk, updating their checksum after each
+ * chunk in the same pass.
+ * @param reader The bit reader, positioned at the start of a code
+ * @param table The decoding table
+ * @param dest The array of size n_chars where to write the characters
+ * @param n_chars The number of characters to decode
+ * @param crc The checksum to update, or NULL for none
+ * @return true on success, false if the codes are not valid
+ */
+static bool decodeChecked(BitReader* reader, const DecodingTable* table,
+                          char* dest, size_t n_chars, uint32_t* crc) {
+    if (!crc) {
+        return decodeCounted(reader, table, dest, n_chars);
+    }
+    for (size_t first = 0; first < n_chars; first += CHECKED_CHUNK_SIZE) {
+        size_t size = n_chars - first < CHECKED_CHUNK_SIZE ?
+                      n_chars - first : CHECKED_CHUNK_SIZE;
+        if (!decodeCounted(reader, table, dest + first, size)) {
+            return false;
+        }
+        *crc = ckCrc32c(*crc, dest + first, size);
+    }
+    return true;
+}
+
+/**
+ * Encodes the ascii characters of a block in DT_STREAMS streams and appends
+ * the jump table and the streams to `encoded`.
+ * @param chars The characters of the block
+ * @param n_ascii The number of ascii characters of the block
+ * @param table The packed coding table
+ * @param encoded The sequence where to append the block
+ * @param crc The checksum of the ascii characters to compute, or NULL
+ * @return true on success, false on error
+ */
+static bool encodeStreams(const char* chars, size_t n_ascii,
+                          const PackedCode* table, BinarySequence* encoded,
+                          uint32_t* crc) {
+    size_t sizes[DT_STREAMS];
+    segmentSizes(n_ascii, sizes);
+
+    BinarySequence* streams[DT_STREAMS] = {NULL};
+    bool success = true;
+    size_t i = 0;
+    for (size_t s = 0; s < DT_STREAMS; s++) {
+        streams[s] = biseCreate();
+        if (!streams[s]) {
+            success = false;
+            break;
+        }
+        // Advance in the block up to the number of ascii characters needed
+        size_t first = i;
+        for (size_t n = 0; n < sizes[s]; i++) {
+            n += chars[i] >= 0 && chars[i] < 127;
+        }
+        BitWriter writer;
+        biseWriterInit(&writer, streams[s]);
+        success &= encodeChecked(chars + first, i - first, &writer, table,
+                                 crc) && biseWriterFlush(&writer);
+    }
+
+    BitWriter writer;
+    biseWriterInit(&writer, encoded);
+    for (size_t s = 0; success && s + 1 < DT_STREAMS; s++) {
+        uint64_t size = (biseGetNumberOfBits(streams[s]) + 7) / 8;
+        for (size_t b = 0; b < JUMP_ENTRY_SIZE; b++) {
+            success &= biseWriteBits(&writer, (size >> (8 * b)) & 0xFF, 8);
+        }
+    }
+    for (size_t s = 0; success && s < DT_STREAMS; s++) {
+        size_t padding = (8 - biseGetNumberOfBits(streams[s]) % 8) % 8;
+        success = biseWriteSequence(&writer, streams[s]) &&
+                  biseWriteBits(&writer, 0, padding);
+    }
+    success &= biseWriterFlush(&writer);
+
+    for (size_t s = 0; s < DT_STREAMS; s++) {
+        biseFree(streams[s]);
+    }
+    return success;
+}
+
+/**
+ * Chooses the code encoding a block in the fewest bits, from the number of
+ * occurrences of its characters.
+ * @param job The encoding job, with the codes to choose from
+ * @param counts An array of size 127 with the occurrences of each character
+ * in the block
+ * @return the number of the code, or n_tables if no code has a code for
+ * every character of the block
+ */
+static size_t chooseTable(const EncodingJob* job, const size_t* counts) {
+    size_t best = job->n_tables;
+    uint64_t bestCost = UINT64_MAX;
+    for (size_t t = 0; t < job->n_tables; t++) {
+        const unsigned char* lengths = job->lengths + t * ASCII_SIZE;
+        uint64_t cost = 0;
+        bool complete = true;
+        for (size_t c = 0; c < ASCII_SIZE; c++) {
+            cost += (uint64_t) counts[c] * lengths[c];
+            complete &= counts[c] == 0 || lengths[c] > 0;
+        }
+        if (complete && cost < bestCost) {
+            best = t;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+static void encodeBlock(void* context, size_t block) {
+    EncodingJob* job = context;
+    size_t first = block * job->blockSize;
+    size_t n_chars = job->n_chars - first < job->blockSize ?
+                     job->n_chars - first : job->blockSize;
+    const char* chars = job->chars + first;
+
+    size_t counts[ASCII_SIZE];
+    memset(counts, 0, sizeof(counts));
+    countCharacters(chars, n_chars, counts);
+    uint32_t n_decoded = 0;
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        n_decoded += (uint32_t) counts[c];
+    }
+    job->n_decoded[block] = n_decoded;
+    job->n_lines[block] = (uint32_t) counts['\n'];
+
+    size_t id = chooseTable(job, counts);
+    if (id == job->n_tables) {
+        job->success[block] = false;
+        return;
+    }
+    const PackedCode* table = job->tables + id * ASCII_SIZE;
+    job->tableIds[block] = (unsigned char) id;
+
+    BinarySequence* encoded = biseCreate();
+    if (!encoded) {
+        job->success[block] = false;
+        return;
+    }
+    job->encoded[block] = encoded;
+
+    // Checksum of the characters the block decodes to, computed as they
+    // are encoded
+    uint32_t crc = 0;
+    uint32_t* checksum = (job->flags & BLOCK_CHECKSUM) ? &crc : NULL;
+    if (job->flags & BLOCK_INTERLEAVED) {
+        job->success[block] = encodeStreams(chars, n_decoded, table,
+                                            encoded, checksum);
+    } else {
+        BitWriter writer;
+        biseWriterInit(&writer, encoded);
+        job->success[block] = encodeChecked(chars, n_chars, &writer, table,
+                                            checksum) &&
+                              biseWriterFlush(&writer);
+    }
+    if (checksum) {
+        job->checksums[block] = crc;
+    }
+}
+
+bool encodeBlocks(const char* chars, size_t n_chars,
+                  const CodingTree* const* trees, size_t n_trees,
+                  const BlockOptions* options, FILE* output) {
+    size_t blockSize = options->blockSize;
+    if (blockSize == 0 || blockSize > UINT32_MAX || n_trees == 0 ||
+        n_trees > BLOCK_MAX_TABLES) {
+        return false;
+    }
+    unsigned char* lengths = malloc(n_trees * ASCII_SIZE);
+    PackedCode* tables = malloc(n_trees * ASCII_SIZE * sizeof(PackedCode));
+    bool success = lengths && tables;
+    for (size_t t = 0; success && t < n_trees; t++) {
+        success = ctCodeLengths(trees[t], lengths + t * ASCII_SIZE) &&
+                  ctCanonicalCodingTable(lengths + t * ASCII_SIZE,
+                                         tables + t * ASCII_SIZE);
+    }
+
+    // Lines are always counted, for a few bytes per block
+    unsigned char flags = options->flags | BLOCK_LINES |
+                          (n_trees > 1 ? BLOCK_TABLES : 0);
+    size_t n_blocks = (n_chars + blockSize - 1) / blockSize;
+    EncodingJob job = {chars, n_chars, blockSize, flags, lengths, tables,
+                       n_trees, NULL, NULL, NULL, NULL, NULL, NULL};
+    job.encoded = calloc(n_blocks + 1, sizeof(BinarySequence*));
+    job.n_decoded = calloc(n_blocks + 1, sizeof(uint32_t));
+    job.checksums = calloc(n_blocks + 1, sizeof(uint32_t));
+    job.n_lines = calloc(n_blocks + 1, sizeof(uint32_t));
+    job.tableIds = calloc(n_blocks + 1, sizeof(unsigned char));
+    job.success = calloc(n_blocks + 1, sizeof(bool));
+    BinarySequence* codeLengths = biseCreate();
+    success = success && job.encoded && job.n_decoded && job.checksums &&
+              job.n_lines && job.tableIds && job.success && codeLengths;
+
+    if (success) {
+        runBlocks(encodeBlock, &job, n_blocks, options->n_threads);
+        for (size_t b = 0; b < n_blocks; b++) {
+            success &= job.success[b];
+        }
+    }
+
+    if (success) {
+        BitWriter writer;
+        biseWriterInit(&writer, codeLengths);
+        if (flags & BLOCK_TABLES) {
+            success = biseWriteBits(&writer, n_trees, 8);
+        }
+        for (size_t t = 0; success && t < n_trees; t++) {
+            success = ctWriteCodeLengths(&writer, lengths + t * ASCII_SIZE);
+        }
+        success = success && biseWriterFlush(&writer);
+    }
+
+    // Header and code lengths
+    if (success) {
+        unsigned char header[HEADER_SIZE];
+        memcpy(header, MAGIC, sizeof(MAGIC));
+        header[4] = VERSION;
+        header[5] = flags;
+        putUint(header + 6, blockSize, 4);
+        putUint(header + 10, n_blocks, 8);
+        success = fwrite(header, 1, HEADER_SIZE, output) == HEADER_SIZE &&
+                  biseWriteToFile(codeLengths, output);
+    }
+
+    // Index, then blocks
+    uint64_t offset = 0;
+    for (size_t b = 0; success && b < n_blocks; b++) {
+        unsigned char entry[INDEX_ENTRY_SIZE + CHECKSUM_SIZE + LINES_SIZE +
+                            TABLE_ID_SIZE];
+        size_t field = INDEX_ENTRY_SIZE;
+        putUint(entry, offset, 8);
+        putUint(entry + 8, job.n_decoded[b], 4);
+        if (flags & BLOCK_CHECKSUM) {
+            putUint(entry + field, job.checksums[b], CHECKSUM_SIZE);
+            field += CHECKSUM_SIZE;
+        }
+        putUint(entry + field, job.n_lines[b], LINES_SIZE);
+        field += LINES_SIZE;
+        if (flags & BLOCK_TABLES) {
+            putUint(entry + field, job.tableIds[b], TABLE_ID_SIZE);
+        }
+        success = fwrite(entry, 1, entrySize(flags), output) ==
+                  entrySize(flags);
+        offset += (biseGetNumberOfBits(job.encoded[b]) + 7) / 8;
+    }
+    for (size_t b = 0; success && b < n_blocks; b++) {
+        success = biseWriteToFile(job.encoded[b], output);
+    }
+
+    if (job.encoded) {
+        for (size_t b = 0; b < n_blocks; b++) {
+            biseFree(job.encoded[b]);
+        }
+    }
+    free(job.encoded);
+    free(job.n_decoded);
+    free(job.checksums);
+    free(job.n_lines);
+    free(job.tableIds);
+    free(job.success);
+    biseFree(codeLengths);
+    free(lengths);
+    free(tables);
+    return success;
+}
+
+/**
+ * Decodes the characters of a block into their slot of the output.
+ * @param job The decoding job
+ * @param block The index of the block
+ * @param crc The checksum of the characters to compute, or NULL
+ * @return true on success, false if the block is not valid
+ */
+static bool decodeBlockChars(const DecodingJob* job, size_t block,
+                             uint32_t* crc) {
+    const unsigned char* start = job->data + job->offsets[block];
+    size_t n_bits = 8 * (size_t) (job->offsets[block + 1] -
+                                  job->offsets[block]);
+
+    char* decoded = job->decoded + job->positions[block];
+    size_t n_chars = job->n_decoded[block];
+    const DecodingTable* table = job->tables[job->tableIds[block]];
+
+    if (!(job->flags & BLOCK_INTERLEAVED)) {
+        BitReader reader;
+        biseReaderInitBuffer(&reader, start, n_bits, 0);
+        return decodeChecked(&reader, table, decoded, n_chars, crc);
+    }
+
+    // Jump table giving where each stream starts
+    size_t jump = (DT_STREAMS - 1) * JUMP_ENTRY_SIZE;
+    if (n_bits < 8 * jump) {
+        return false;
+    }
+    size_t sizes[DT_STREAMS];
+    segmentSizes(n_chars, sizes);
+    BitReader readers[DT_STREAMS];
+    char* dests[DT_STREAMS];
+    size_t stream = jump, n_bytes = n_bits / 8;
+    for (size_t s = 0; s < DT_STREAMS; s++) {
+        size_t size = s + 1 < DT_STREAMS ?
+                      getUint(start + s * JUMP_ENTRY_SIZE, JUMP_ENTRY_SIZE) :
+                      n_bytes - stream;
+        if (size > n_bytes - stream) {
+            return false;
+        }
+        biseReaderInitBuffer(&readers[s], start + stream, 8 * size, 0);
+        dests[s] = decoded;
+        decoded += sizes[s];
+        stream += size;
+    }
+
+    // All streams together while they all have characters left, then the
+    // remaining characters of the longer ones. With a checksum, each
+    // segment is checksummed chunk by chunk as it is decoded, and the
+    // checksums of the segments are joined at the end.
+    size_t n_common = sizes[DT_STREAMS - 1];
+    size_t step = crc ? CHECKED_CHUNK_SIZE / DT_STREAMS : n_common;
+    uint32_t crcs[DT_STREAMS] = {0};
+    bool success = true;
+    for (size_t first = 0; success && first < n_common; first += step) {
+        size_t size = n_common - first < step ? n_common - first : step;
+        char* chunks[DT_STREAMS];
+        for (size_t s = 0; s < DT_STREAMS; s++) {
+            chunks[s] = dests[s] + first;
+        }
+        success = dtDecodeInterleaved(table, readers, chunks, size);
+        for (size_t s = 0; crc && s < DT_STREAMS; s++) {
+            crcs[s] = ckCrc32c(crcs[s], chunks[s], size);
+        }
+    }
+    for (size_t s = 0; success && s < DT_STREAMS; s++) {
+        success = decodeChecked(&readers[s], table, dests[s] + n_common,
+                                sizes[s] - n_common, crc ? &crcs[s] : NULL);
+    }
+    for (size_t s = 0; crc && s < DT_STREAMS; s++) {
+        *crc = ckCrc32cCombine(*crc, crcs[s], sizes[s]);
+    }
+    return success;
+}
+
+static void decodeBlock(void* context, size_t block) {
+    DecodingJob* job = context;
+    block += job->first;
+    uint32_t crc = 0;
+    bool success = decodeBlockChars(job, block,
+                                    job->checksums ? &crc : NULL);
+    if (success && job->checksums) {
+        success = crc == job->checksums[block];
+    }
+    job->success[block] = success;
+}
+
+bool decodeBlocks(const unsigned char* bytes, size_t n_bytes,
+                  const BlockOptions* options, FILE* output) {
+    unsigned char flags = n_bytes >= HEADER_SIZE ? bytes[5] : 0;
+    if (n_bytes < HEADER_SIZE || memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0 ||
+        bytes[4] != VERSION ||
+        (flags & ~(BLOCK_INTERLEAVED | BLOCK_CHECKSUM | BLOCK_LINES |
+                   BLOCK_TABLES)) ||
+        (options->lines && !(flags & BLOCK_LINES))) {
+        return false;
+    }
+    uint64_t n_blocks = getUint(bytes + 10, 8);
+
+    // Number of codes, then their code lengths
+    BitReader reader;
+    biseReaderInitBuffer(&reader, bytes, 8 * n_bytes, 8 * HEADER_SIZE);
+    size_t n_tables = 1;
+    if (flags & BLOCK_TABLES) {
+        n_tables = (size_t) biseReaderPeek(&reader, 8);
+        biseReaderConsume(&reader, 8);
+    }
+    DecodingTable** tables = calloc(n_tables + 1, sizeof(DecodingTable*));
+    bool success = tables && n_tables > 0;
+    for (size_t t = 0; success && t < n_tables; t++) {
+        unsigned char lengths[ASCII_SIZE];
+        PackedCode codes[ASCII_SIZE];
+        success = ctReadCodeLengths(&reader, lengths) &&
+                  ctCanonicalCodingTable(lengths, codes) &&
+                  (tables[t] = dtCreate(codes)) != NULL;
+    }
+    size_t index = (biseReaderTell(&reader) + 7) / 8;
+    if (!success || index > n_bytes ||
+        n_blocks > (n_bytes - index) / entrySize(flags)) {
+        freeTables(tables, n_tables);
+        return false;
+    }
+    size_t data = index + n_blocks * entrySize(flags);
+
+    uint64_t* offsets = malloc((n_blocks + 1) * sizeof(uint64_t));
+    uint32_t* n_decoded = malloc((n_blocks + 1) * sizeof(uint32_t));
+    size_t* positions = malloc((n_blocks + 1) * sizeof(size_t));
+    uint32_t* crcs = malloc((n_blocks + 1) * sizeof(uint32_t));
+    size_t* lines = malloc((n_blocks + 1) * sizeof(size_t));
+    unsigned char* tableIds = malloc((n_blocks + 1) * sizeof(unsigned char));
+    bool* blockSuccess = malloc((n_blocks + 1) * sizeof(bool));
+    success = offsets && n_decoded && positions && crcs && lines &&
+              tableIds && blockSuccess;
+
+    // Index, the blocks being stored one after the other. Positions and
+    // lines are the numbers of characters and of newlines before each block.
+    size_t n_chars = 0, n_lines = 0;
+    for (size_t b = 0; success && b < n_blocks; b++) {
+        const unsigned char* entry = bytes + index + b * entrySize(flags);
+        size_t field = INDEX_ENTRY_SIZE;
+        offsets[b] = getUint(entry, 8);
+        n_decoded[b] = (uint32_t) getUint(entry + 8, 4);
+        crcs[b] = 0;
+        if (flags & BLOCK_CHECKSUM) {
+            crcs[b] = (uint32_t) getUint(entry + field, CHECKSUM_SIZE);
+            field += CHECKSUM_SIZE;
+        }
+        positions[b] = n_chars;
+        lines[b] = n_lines;
+        n_chars += n_decoded[b];
+        if (flags & BLOCK_LINES) {
+            n_lines += getUint(entry + field, LINES_SIZE);
+            field += LINES_SIZE;
+        }
+        tableIds[b] = 0;
+        if (flags & BLOCK_TABLES) {
+            tableIds[b] = (unsigned char) getUint(entry + field,
+                                                  TABLE_ID_SIZE);
+        }
+        success = offsets[b] <= n_bytes - data &&
+                  (b == 0 || offsets[b] >= offsets[b - 1]) &&
+                  tableIds[b] < n_tables;
+    }
+    if (success) {
+        offsets[n_blocks] = n_bytes - data;
+        positions[n_blocks] = n_chars;
+        lines[n_blocks] = n_lines;
+    }
+
+    // Blocks [firstBlock, lastBlock) overlapping the range. For lines, from
+    // the one holding the newline before the first line to the one holding
+    // the newline ending the last line.
+    size_t first = options->first;
+    size_t last = first + (options->length < SIZE_MAX - first ?
+                           options->length : SIZE_MAX - first);
+    const size_t* starts = options->lines ? lines : positions;
+    size_t firstBlock = 0, lastBlock = 0;
+    while (success && firstBlock < n_blocks &&
+           (options->lines ? starts[firstBlock + 1] < first :
+                             starts[firstBlock + 1] <= first)) {
+        firstBlock++;
+    }
+    lastBlock = firstBlock;
+    while (success && last > first && lastBlock < n_blocks &&
+           starts[lastBlock] < last) {
+        lastBlock++;
+    }
+
+    // Only these blocks are decoded, in a buffer starting with the first one
+    size_t base = success ? positions[firstBlock] : 0;
+    size_t size = success ? positions[lastBlock] - base : 0;
+    char* decoded = success ? malloc(size + 1) : NULL;
+    success = success && decoded;
+    if (success) {
+        for (size_t b = firstBlock; b <= lastBlock; b++) {
+            positions[b] -= base;
+        }
+
+        // Each block decodes straight into its slot of the output
+        DecodingJob job = {bytes + data, tables, tableIds, offsets, n_decoded,
+                           positions, (flags & BLOCK_CHECKSUM) ? crcs : NULL,
+                           flags, firstBlock, decoded, blockSuccess};
+        runBlocks(decodeBlock, &job, lastBlock - firstBlock,
+                  options->n_threads);
+        for (size_t b = firstBlock; b < lastBlock; b++) {
+            success &= blockSuccess[b];
+        }
+    }
+
+    // Characters of the range in the decoded blocks
+    size_t start = 0, end = 0;
+    if (success && options->lines) {
+        start = skipLines(decoded, size, first - lines[firstBlock]);
+        end = start + skipLines(decoded + start, size - start, last - first);
+    } else if (success) {
+        start = first - base < size ? first - base : size;
+        end = last - base < size ? last - base : size;
+    }
+    success = success &&
+              fwrite(decoded + start, 1, end - start, output) == end - start;
+
+    freeTables(tables, n_tables);
+    free(offsets);
+    free(n_decoded);
+    free(positions);
+    free(crcs);
+    free(lines);
+    free(tableIds);
+    free(blockSuccess);
+    free(decoded);
+    return success;
+}
@@ -0,0 +1,120 @@
+/* ========================================================================= *
+ * Block coding interface.
+ *
+ * The text is split into blocks of a fixed number of bytes, each encoded
+ * independently with a canonical code into a byte-aligned chunk of bits.
+ * Several codes can be given, e.g. built from the frequencies of different
+ * languages: each block is then encoded with the code giving the fewest
+ * bits for its characters, as counted in the block. Blocks are encoded by a
+ * pool of threads; since each block only depends on its own bytes, the
+ * output does not depend on the number of threads. Thanks to the index,
+ * blocks are decoded in parallel as well, each one directly at its position
+ * in the decoded text. The index is also a seek index: a range of the
+ * decoded text, of characters or of lines, is decoded from the blocks it
+ * overlaps only, the other ones being neither read nor decoded.
+ *
+ * FORMAT
+ * All integers are stored in little endian.
+ * - Magic "HUFB" (4 bytes), version (1 byte), flags (1 byte, see below)
+ * - Block size in bytes (4 bytes), number of blocks N (8 bytes)
+ * - With BLOCK_TABLES, number of codes T (1 byte)
+ * - Code lengths of the T codes (a single one without BLOCK_TABLES), one
+ *   after the other, as written by `ctWriteCodeLengths`, padded to a byte
+ * - Index of N entries: offset of the block from the start of the data
+ *   (8 bytes), number of characters it decodes to (4 bytes), then with
+ *   BLOCK_CHECKSUM, CRC-32C of these characters (4 bytes), with
+ *   BLOCK_LINES, number of newlines among them (4 bytes) and with
+ *   BLOCK_TABLES, number of the code the block is encoded with (1 byte)
+ * - Data: the encoded blocks, one after the other. There is no end of file
+ *   character, the index gives the number of characters of each block.
+ *
+ * FLAGS
+ * - BLOCK_INTERLEAVED: the characters of each block are split into
+ *   DT_STREAMS consecutive segments of ceil(n / DT_STREAMS) characters (the
+ *   last ones may be shorter), each encoded in its own byte-aligned stream.
+ *   The block starts with the size in bytes of all streams but the last
+ *   (4 bytes each), followed by the streams.
+ * - BLOCK_CHECKSUM: the index holds the checksum of each block, computed
+ *   by the thread encoding the block and checked by the one decoding it,
+ *   right after it is decoded.
+ * - BLOCK_LINES: the index holds the number of newlines of each block, so
+ *   that lines are found by number. Always set by `encodeBlocks`.
+ * - BLOCK_TABLES: the blocks are encoded with one of several codes. Set by
+ *   `encodeBlocks` when it is given more than one code.
+ * ========================================================================= */
+
+#ifndef _BLOCK_CODING_H_
+#define _BLOCK_CODING_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "CodingTree.h"
+
+#define BLOCK_INTERLEAVED 0x01
+#define BLOCK_CHECKSUM 0x02
+#define BLOCK_LINES 0x04
+#define BLOCK_TABLES 0x08
+
+/* Maximum number of codes a file encoded by blocks can choose from */
+#define BLOCK_MAX_TABLES 255
+
+typedef struct block_options_t {
+    // Number of characters per block (the last block may be smaller).
+    size_t blockSize;
+    // Number of threads (de)coding the blocks.
+    size_t n_threads;
+    // Combination of the BLOCK_* flags, for encoding only.
+    unsigned char flags;
+    // Range of the decoded text to output, for decoding only: `length`
+    // characters from the `first` one (0 and SIZE_MAX for the whole text),
+    // or lines if `lines` is set. Lines are numbered from 0 and include
+    // their newline.
+    size_t first;
+    size_t length;
+    bool lines;
+} BlockOptions;
+
+/* ------------------------------------------------------------------------- *
+ * Encode an ascii encoded text block by block and write the result.
+ *
+ * PARAMETERS
+ * chars        The characters to encode
+ * n_chars      The number of characters to encode
+ * trees        The coding trees whose canonical codes the blocks choose
+ *              from, each block using the one which encodes it in the
+ *              fewest bits
+ * n_trees      The number of trees, from 1 to BLOCK_MAX_TABLES
+ * options      The block size, number of threads and flags. Non-ascii
+ *              characters are filtered out as in `encode`, so blocks may
+ *              decode to less characters than the block size.
+ * output       The file where to write the encoded blocks
+ *
+ * RETURN
+ * success      True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool encodeBlocks(const char* chars, size_t n_chars,
+                  const CodingTree* const* trees, size_t n_trees,
+                  const BlockOptions* options, FILE* output);
+
+/* ------------------------------------------------------------------------- *
+ * Decode a text encoded by `encodeBlocks` and write the result.
+ *
+ * PARAMETERS
+ * bytes        The encoded file
+ * n_bytes      The number of bytes of the encoded file
+ * options      The number of threads decoding the blocks and the range of
+ *              the decoded text to write, other fields are read from the
+ *              file. The range is cut at the end of the text. A range of
+ *              lines needs a file with BLOCK_LINES.
+ * output       The file where to write the decoded text
+ *
+ * RETURN
+ * success      True on success, false on error, if the file is not valid or
+ *              if a block does not match its checksum
+ * ------------------------------------------------------------------------- */
+bool decodeBlocks(const unsigned char* bytes, size_t n_bytes,
+                  const BlockOptions* options, FILE* output);
+
+#endif // _BLOCK_CODING_H_
@@ -0,0 +1,28 @@
+#include <string.h>
+
+#include "BuiltinCodes.h"
+
+#ifdef HUFFMAN_BUILTIN_CODES
+// Defines BUILTIN_CODES and N_BUILTIN_CODES
+#include "BuiltinTables.h"
+#else
+static const BuiltinCode BUILTIN_CODES[1] = {{NULL, NULL, NULL}};
+static const size_t N_BUILTIN_CODES = 0;
+#endif
+
+const BuiltinCode* bcFind(const char* name) {
+    for (size_t i = 0; i < N_BUILTIN_CODES; i++) {
+        if (strcmp(BUILTIN_CODES[i].name, name) == 0) {
+            return &BUILTIN_CODES[i];
+        }
+    }
+    return NULL;
+}
+
+size_t bcCount(void) {
+    return N_BUILTIN_CODES;
+}
+
+const BuiltinCode* bcGet(size_t index) {
+    return &BUILTIN_CODES[index];
+}
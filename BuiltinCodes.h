@@ -0,0 +1,56 @@
+/* ========================================================================= *
+ * Built-in codes interface.
+ *
+ * NOTE
+ * - The built-in codes are generated at build time by `gentables` from
+ *   frequency CSV files, into a header defining the constant coding and
+ *   decoding tables of each code. They are the codes `ctHuffman` builds
+ *   from the same CSV files, so that a text encoded with a built-in code
+ *   can be decoded with the CSV and conversely.
+ * - Without HUFFMAN_BUILTIN_CODES defined, there is no built-in code.
+ * ========================================================================= */
+
+#ifndef _BUILTIN_CODES_H_
+#define _BUILTIN_CODES_H_
+
+#include <stddef.h>
+
+#include "CodingTree.h"
+#include "DecodingTable.h"
+
+typedef struct builtin_code_t {
+    // Name under which the code is selected.
+    const char* name;
+    // Packed code of each ascii character.
+    const PackedCode* codes;
+    const DecodingTable* table;
+} BuiltinCode;
+
+/* ------------------------------------------------------------------------- *
+ * Find a built-in code by name. Nothing is parsed nor allocated.
+ *
+ * PARAMETERS
+ * name         The name of the code
+ *
+ * RETURN
+ * code         The built-in code, or NULL if there is none with this name
+ * ------------------------------------------------------------------------- */
+const BuiltinCode* bcFind(const char* name);
+
+/* ------------------------------------------------------------------------- *
+ * Return the number of built-in codes.
+ * ------------------------------------------------------------------------- */
+size_t bcCount(void);
+
+/* ------------------------------------------------------------------------- *
+ * Return the ith built-in code.
+ *
+ * PARAMETERS
+ * index        The index of the code, less than `bcCount()`
+ *
+ * RETURN
+ * code         The built-in code
+ * ------------------------------------------------------------------------- */
+const BuiltinCode* bcGet(size_t index);
+
+#endif // _BUILTIN_CODES_H_
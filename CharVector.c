@@ -59,6 +59,24 @@ bool cvAdd(CharVector* charVector, char c)
     return true;
 }
 
+char* cvExtend(CharVector* charVector, size_t n)
+{
+    if(n > charVector->capacity - charVector->size)
+    {
+        char* newContent = (char*)realloc(charVector->content,
+                                          charVector->size + n);
+        if(!newContent)
+            return NULL;
+
+        charVector->content = newContent;
+        charVector->capacity = charVector->size + n;
+    }
+
+    char* chars = charVector->content + charVector->size;
+    charVector->size += n;
+    return chars;
+}
+
 char cvGet(const CharVector* charVector, size_t index)
 {
     return charVector->content[index];
@@ -49,6 +49,21 @@ void cvFree(CharVector* charVector);
 bool cvAdd(CharVector* charVector, char c);
 
 
+/* ------------------------------------------------------------------------- *
+ * Add `n` characters at the end of the vector `vector`, to be written by the
+ * caller. The vector grows by exactly `n` characters if needed.
+ *
+ * PARAMETERS
+ * charVector   A valid pointer to the vector in which to add the characters
+ * n            The number of characters to add
+ *
+ * RETURN
+ * chars        A pointer to the first added character, or NULL in case of
+ *              error
+ * ------------------------------------------------------------------------- */
+char* cvExtend(CharVector* charVector, size_t n);
+
+
 /* ------------------------------------------------------------------------- *
  * Retrieve the character at index `index` for the given vector.
  *
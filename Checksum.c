@@ -0,0 +1,96 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "Checksum.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CHECKSUM_SSE42
+#include <nmmintrin.h>
+#endif
+
+// Reflected Castagnoli polynomial
+static const uint32_t POLYNOMIAL = 0x82F63B78;
+
+typedef uint32_t (*Crc32c)(uint32_t crc, const unsigned char* bytes,
+                           size_t n_bytes);
+
+static pthread_once_t initialized = PTHREAD_ONCE_INIT;
+static uint32_t table[256];
+static Crc32c update;
+
+static uint32_t crc_table(uint32_t crc, const unsigned char* bytes,
+                          size_t n_bytes) {
+    for (size_t i = 0; i < n_bytes; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc_sse42(uint32_t crc, const unsigned char* bytes,
+                          size_t n_bytes) {
+    size_t i = 0;
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    for (; i + 8 <= n_bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t) crc64;
+#endif
+    for (; i < n_bytes; i++) {
+        crc = _mm_crc32_u8(crc, bytes[i]);
+    }
+    return crc;
+}
+#endif
+
+static void initialize(void) {
+    for (uint32_t b = 0; b < 256; b++) {
+        uint32_t crc = b;
+        for (size_t k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+        }
+        table[b] = crc;
+    }
+
+    update = crc_table;
+#ifdef CHECKSUM_SSE42
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        update = crc_sse42;
+    }
+#endif
+}
+
+uint32_t ckCrc32c(uint32_t crc, const void* bytes, size_t n_bytes) {
+    pthread_once(&initialized, initialize);
+    return ~update(~crc, bytes, n_bytes);
+}
+
+// Product of two polynomials modulo the polynomial, bit 31 being x^0
+static uint32_t multiply_mod(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+        }
+        b = (b >> 1) ^ (b & 1 ? POLYNOMIAL : 0);
+    }
+    return product;
+}
+
+uint32_t ckCrc32cCombine(uint32_t crc1, uint32_t crc2, size_t n_bytes2) {
+    // Shifting crc1 over the second bytes multiplies it by x^(8 n_bytes2),
+    // computed by squaring x^8
+    uint32_t shift = 1u << 31, power = 1u << 23;
+    for (size_t n = n_bytes2; n != 0; n >>= 1) {
+        if (n & 1) {
+            shift = multiply_mod(power, shift);
+        }
+        power = multiply_mod(power, power);
+    }
+    return multiply_mod(shift, crc1) ^ crc2;
+}
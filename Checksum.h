@@ -0,0 +1,51 @@
+/* ========================================================================= *
+ * Checksum interface.
+ *
+ * NOTE
+ * - CRC-32C (Castagnoli), computed with the crc32 instruction of SSE 4.2
+ *   when the processor has it, eight bytes at a time, and with a table
+ *   otherwise. Both give the same checksums.
+ * ========================================================================= */
+
+#ifndef _CHECKSUM_H_
+#define _CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ------------------------------------------------------------------------- *
+ * Update the CRC-32C of some bytes with the bytes that follow them.
+ *
+ * PARAMETERS
+ * crc          The checksum of the previous bytes, 0 for none
+ * bytes        The following bytes
+ * n_bytes      The number of following bytes
+ *
+ * NOTE
+ * Checksumming some bytes in several calls gives the same checksum as in a
+ * single one.
+ *
+ * RETURN
+ * crc          The checksum of all the bytes
+ * ------------------------------------------------------------------------- */
+uint32_t ckCrc32c(uint32_t crc, const void* bytes, size_t n_bytes);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the CRC-32C of two byte ranges put end to end from their own
+ * checksums, without reading their bytes.
+ *
+ * PARAMETERS
+ * crc1         The checksum of the first bytes
+ * crc2         The checksum of the second bytes
+ * n_bytes2     The number of second bytes
+ *
+ * NOTE
+ * Runs in O(log(n_bytes2)), so that ranges checksummed separately, e.g. in
+ * the same pass as they are decoded, can be joined at little cost.
+ *
+ * RETURN
+ * crc          The checksum of the first bytes followed by the second ones
+ * ------------------------------------------------------------------------- */
+uint32_t ckCrc32cCombine(uint32_t crc1, uint32_t crc2, size_t n_bytes2);
+
+#endif // _CHECKSUM_H_
@@ -8,131 +8,515 @@
 
 static const size_t ASCII_SIZE = 127;
 
-static void ctCodingTable_aux(const CodingTree* tree, BinarySequence** table,
+typedef struct node_t Node;
+
+static void ctCodingTable_aux(const CodingTree* tree, uint16_t node,
+                              BinarySequence** table,
                               BinarySequence* bin_seq);
+static bool ctPackedCodingTable_aux(const CodingTree* tree, uint16_t node,
+                                    PackedCode* table, uint64_t code,
+                                    size_t length);
+static const size_t LENGTH_WIDTH_BITS = 6;
+static const uint16_t NO_CHILD = UINT16_MAX;
+// Number of nodes of a tree with a leaf for each ascii character
+static const size_t MAX_NODES = 2 * 127 - 1;
+
+// A node of the tree, whose children are indices in the node array.
+struct node_t {
+    // NO_CHILD for leaves.
+    uint16_t left;
+    uint16_t right;
+    char character;
+};
 
 struct coding_tree_t {
-    char character;
-    double frequency;
+    size_t n_nodes;
+    size_t capacity;
+    uint16_t root;
 
-    CodingTree* left;
-    CodingTree* right;
+    // All the nodes, allocated along with the structure.
+    Node nodes[];
 };
 
+/**
+ * Allocates an empty tree, with room for `capacity` nodes.
+ * @param capacity The maximum number of nodes of the tree
+ * @return the tree, or NULL on error
+ */
+static CodingTree* tree_create(size_t capacity) {
+    if (capacity >= NO_CHILD) {
+        return NULL;
+    }
+
+    CodingTree* tree = malloc(sizeof(CodingTree) + capacity * sizeof(Node));
+    if (tree == NULL) {
+        return NULL;
+    }
+
+    tree->n_nodes = 0;
+    tree->capacity = capacity;
+    tree->root = 0;
+
+    return tree;
+}
+
+/**
+ * Appends a node to a tree, which must have room for it.
+ * @param tree The tree
+ * @param left The index of the left child, or NO_CHILD
+ * @param right The index of the right child, or NO_CHILD
+ * @param c The character of the node, for leaves
+ * @return the index of the new node
+ */
+static uint16_t tree_add(CodingTree* tree, uint16_t left, uint16_t right,
+                         char c) {
+    Node* node = &tree->nodes[tree->n_nodes];
+    node->left = left;
+    node->right = right;
+    node->character = c;
+
+    return (uint16_t) tree->n_nodes++;
+}
+
+/**
+ * Appends all the nodes of `source` to `dest`, which must have room for
+ * them.
+ * @param dest The tree where to copy the nodes
+ * @param source The tree to copy
+ * @return the index of the root of `source` in `dest`
+ */
+static uint16_t tree_append(CodingTree* dest, const CodingTree* source) {
+    uint16_t offset = (uint16_t) dest->n_nodes;
+    for (size_t i = 0; i < source->n_nodes; i++) {
+        const Node* node = &source->nodes[i];
+        bool leaf = node->left == NO_CHILD;
+        tree_add(dest, leaf ? NO_CHILD : node->left + offset,
+                 leaf ? NO_CHILD : node->right + offset, node->character);
+    }
+
+    return source->root + offset;
+}
+
 CodingTree* ctCreateLeaf(char c, double frequency) {
-    CodingTree* leaf = malloc(sizeof(CodingTree));
+    (void) frequency;
 
+    CodingTree* leaf = tree_create(1);
     if (leaf == NULL) {
         return NULL;
     }
 
-    leaf->left = NULL;
-    leaf->right = NULL;
-    leaf->character = c;
-    leaf->frequency = frequency;
+    leaf->root = tree_add(leaf, NO_CHILD, NO_CHILD, c);
 
     return leaf;
 }
 
 CodingTree* ctMerge(CodingTree* leftTree, CodingTree* rightTree) {
-    CodingTree* parent = malloc(sizeof(CodingTree));
+    CodingTree* parent = tree_create(leftTree->n_nodes +
+                                     rightTree->n_nodes + 1);
     if (parent == NULL) {
         return NULL;
     }
 
-    parent->right = rightTree;
-    parent->left = leftTree;
-    parent->frequency = leftTree->frequency + rightTree->frequency;
+    uint16_t left = tree_append(parent, leftTree);
+    uint16_t right = tree_append(parent, rightTree);
+    parent->root = tree_add(parent, left, right, 0);
+
+    free(leftTree);
+    free(rightTree);
 
     return parent;
 }
 
 void ctFree(CodingTree* tree) {
-    if(tree->left != NULL) {
-        ctFree(tree->left);
-    }
-    if(tree->right != NULL) {
-        ctFree(tree->right);
-    }
     free(tree);
 }
 
 CodingTree* ctHuffman(const double* frequencies) {
-    CodingTree** ascii_chars = malloc(ASCII_SIZE * sizeof(CodingTree*));
-
-    if (ascii_chars == NULL) {
+    CodingTree* tree = tree_create(MAX_NODES);
+    if (tree == NULL) {
         return NULL;
     }
 
+    // The queue holds pointers to the nodes, whose weights are kept aside
+    // as they are only needed while building
+    const Node* ascii_chars[ASCII_SIZE];
+    double weights[MAX_NODES];
     for (size_t c = 0; c < ASCII_SIZE; c++) {
-        CodingTree* leaf = ctCreateLeaf(c, frequencies[c]);
-        ascii_chars[c] = leaf;
+        uint16_t leaf = tree_add(tree, NO_CHILD, NO_CHILD, (char) c);
+        ascii_chars[c] = &tree->nodes[leaf];
+        weights[leaf] = frequencies[c];
     }
 
     PriorityQueue* queue = pqCreate((const void**) ascii_chars, frequencies,
                                     ASCII_SIZE);
+    if (queue == NULL) {
+        ctFree(tree);
+        return NULL;
+    }
 
     while (pqSize(queue) > 1) {
-        CodingTree* left_leaf = (CodingTree*) pqExtractMin(queue);
-        CodingTree* right_leaf = (CodingTree*) pqExtractMin(queue);
+        uint16_t left = (uint16_t) ((const Node*) pqExtractMin(queue) -
+                                    tree->nodes);
+        uint16_t right = (uint16_t) ((const Node*) pqExtractMin(queue) -
+                                     tree->nodes);
 
-        CodingTree* parent = ctMerge(left_leaf, right_leaf);
+        uint16_t parent = tree_add(tree, left, right, 0);
+        weights[parent] = weights[left] + weights[right];
 
-        pqInsert(queue, parent, parent->frequency);
+        pqInsert(queue, &tree->nodes[parent], weights[parent]);
     }
 
-    CodingTree* final_tree = (CodingTree*) pqExtractMin(queue);
+    tree->root = (uint16_t) ((const Node*) pqExtractMin(queue) - tree->nodes);
 
     pqFree(queue);
-    free(ascii_chars);
 
-    return final_tree;
+    return tree;
+}
+
+/**
+ * Sorts the characters by increasing frequency. Insertion sort, which is
+ * as fast as it gets for 127 characters, keeps equal frequencies in the
+ * order of the characters.
+ * @param frequencies The frequency of each ascii character
+ * @param skipAbsent Whether to leave out characters with zero frequency
+ * @param order An array of size 127 to fill with the sorted characters
+ * @return the number of sorted characters
+ */
+static size_t sort_characters(const double* frequencies, bool skipAbsent,
+                              size_t* order) {
+    size_t n = 0;
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        if (skipAbsent && frequencies[c] <= 0) {
+            continue;
+        }
+        size_t i = n++;
+        for (; i > 0 && frequencies[order[i - 1]] > frequencies[c]; i--) {
+            order[i] = order[i - 1];
+        }
+        order[i] = c;
+    }
+    return n;
+}
+
+/**
+ * Builds the tree holding the canonical codes of the given lengths.
+ * @param lengths The code length of each ascii character, zero if absent
+ * @return the tree, or NULL on error
+ */
+static CodingTree* tree_from_lengths(const unsigned char* lengths) {
+    PackedCode codes[ASCII_SIZE];
+    if (!ctCanonicalCodingTable(lengths, codes)) {
+        return NULL;
+    }
+
+    CodingTree* tree = tree_create(MAX_NODES);
+    if (tree == NULL) {
+        return NULL;
+    }
+    tree->root = tree_add(tree, NO_CHILD, NO_CHILD, 0);
+
+    // Follow the code of each character from the root, creating the
+    // missing nodes
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        uint16_t node = tree->root;
+        for (size_t i = ctCodeLength(codes[c]); i-- > 0;) {
+            uint16_t* child = (ctCodeBits(codes[c]) >> i) & 1 ?
+                              &tree->nodes[node].right :
+                              &tree->nodes[node].left;
+            if (*child == NO_CHILD) {
+                if (tree->n_nodes == tree->capacity) {
+                    ctFree(tree);
+                    return NULL;
+                }
+                *child = tree_add(tree, NO_CHILD, NO_CHILD,
+                                  i == 0 ? (char) c : 0);
+            }
+            node = *child;
+        }
+    }
+
+    return tree;
+}
+
+bool ctHuffmanCodeLengths(const double* frequencies, bool skipAbsent,
+                          unsigned char* lengths) {
+    size_t order[ASCII_SIZE];
+    size_t n = sort_characters(frequencies, skipAbsent, order);
+    memset(lengths, 0, ASCII_SIZE);
+    if (n == 0) {
+        return false;
+    }
+    if (n == 1) { // A code needs at least one bit, a full tree two leaves
+        lengths[order[0]] = 1;
+        lengths[order[0] == 0 ? 1 : 0] = 1;
+        return true;
+    }
+
+    // Nodes are numbered leaves first (0 to n - 1), then internal nodes
+    // (n to 2n - 2) in order of creation. Internal nodes are created with
+    // increasing weights, so the two lightest nodes are always at the
+    // front of either the leaves or the internal nodes: no priority queue
+    // is needed.
+    double weights[ASCII_SIZE];
+    size_t parents[2 * ASCII_SIZE];
+    size_t leaf = 0, node = 0;
+    for (size_t k = 0; k < n - 1; k++) {
+        weights[k] = 0;
+        for (size_t pick = 0; pick < 2; pick++) {
+            if (leaf < n && (node == k ||
+                frequencies[order[leaf]] <= weights[node])) {
+                weights[k] += frequencies[order[leaf]];
+                parents[leaf++] = n + k;
+            } else {
+                weights[k] += weights[node];
+                parents[n + node++] = n + k;
+            }
+        }
+    }
+
+    // Depths of the internal nodes from the root, the last one created,
+    // then code lengths of the leaves
+    size_t depths[ASCII_SIZE];
+    depths[n - 2] = 0;
+    for (size_t k = n - 2; k-- > 0;) {
+        depths[k] = depths[parents[n + k] - n] + 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t length = depths[parents[i] - n] + 1;
+        if (length > CT_MAX_PACKED_LENGTH) {
+            return false;
+        }
+        lengths[order[i]] = (unsigned char) length;
+    }
+
+    return true;
+}
+
+CodingTree* ctHuffmanLinear(const double* frequencies, bool skipAbsent) {
+    unsigned char lengths[ASCII_SIZE];
+    if (!ctHuffmanCodeLengths(frequencies, skipAbsent, lengths)) {
+        return NULL;
+    }
+
+    return tree_from_lengths(lengths);
 }
 
-static void bise_print(BinarySequence* bs) {
-    for(int i = 0; i < biseGetNumberOfBits(bs); i++) {
-        printf("%d", biseGetBit(bs, i));
+bool ctLimitedCodeLengths(const double* frequencies, size_t maxLength,
+                          unsigned char* lengths) {
+    if (maxLength > CT_MAX_PACKED_LENGTH ||
+        (((uint64_t) 1) << maxLength) < ASCII_SIZE) {
+        return false;
+    }
+
+    // Characters by increasing frequency
+    size_t order[ASCII_SIZE];
+    sort_characters(frequencies, false, order);
+
+    // Each level holds the characters and the packages of pairs of items
+    // of the level below, by increasing weight. Level 0 is the deepest.
+    const size_t width = 2 * ASCII_SIZE;
+    double* weights = malloc(maxLength * width * sizeof(double));
+    int* symbols = malloc(maxLength * width * sizeof(int)); // -1: package
+    size_t* sizes = malloc(maxLength * sizeof(size_t));
+    if (!weights || !symbols || !sizes) {
+        free(weights);
+        free(symbols);
+        free(sizes);
+        return false;
+    }
+
+    for (size_t i = 0; i < ASCII_SIZE; i++) {
+        weights[i] = frequencies[order[i]];
+        symbols[i] = (int) order[i];
+    }
+    sizes[0] = ASCII_SIZE;
+
+    for (size_t level = 1; level < maxLength; level++) {
+        const double* below = weights + (level - 1) * width;
+        double* weight = weights + level * width;
+        int* symbol = symbols + level * width;
+        size_t n_packages = sizes[level - 1] / 2;
+
+        size_t n = 0, leaf = 0, package = 0;
+        while (leaf < ASCII_SIZE || package < n_packages) {
+            double package_weight = package < n_packages ?
+                                    below[2 * package] +
+                                    below[2 * package + 1] : 0;
+            if (package == n_packages || (leaf < ASCII_SIZE &&
+                frequencies[order[leaf]] <= package_weight)) {
+                weight[n] = frequencies[order[leaf]];
+                symbol[n++] = (int) order[leaf++];
+            } else {
+                weight[n] = package_weight;
+                symbol[n++] = -1;
+                package++;
+            }
+        }
+        sizes[level] = n;
+    }
+
+    // The 2n - 2 lightest items of the top level give the code lengths:
+    // each character is one bit longer for every level it is selected at
+    memset(lengths, 0, ASCII_SIZE);
+    size_t selected = 2 * ASCII_SIZE - 2;
+    for (size_t level = maxLength; level-- > 0;) {
+        const int* symbol = symbols + level * width;
+        size_t n_packages = 0;
+        for (size_t i = 0; i < selected; i++) {
+            if (symbol[i] < 0) {
+                n_packages++;
+            } else {
+                lengths[symbol[i]]++;
+            }
+        }
+        selected = 2 * n_packages;
+    }
+
+    free(weights);
+    free(symbols);
+    free(sizes);
+    return true;
+}
+
+CodingTree* ctHuffmanLimited(const double* frequencies, size_t maxLength) {
+    unsigned char lengths[ASCII_SIZE];
+    if (!ctLimitedCodeLengths(frequencies, maxLength, lengths)) {
+        return NULL;
     }
+
+    return tree_from_lengths(lengths);
 }
 
 BinarySequence** ctCodingTable(const CodingTree* tree) {
     BinarySequence** table = calloc(ASCII_SIZE, sizeof(BinarySequence*));
-
-    for(char i = 0; i < ASCII_SIZE; i++) {
-        BinarySequence* sequence = biseCreate();
-        biseAddByte(sequence, i);
-        printf("\n");
-        printf("%c\n", i);
-        bise_print(sequence);
-        printf("\n");
-        table[i] = sequence;
+    if (table == NULL) {
+        return NULL;
     }
 
+    ctCodingTable_aux(tree, tree->root, table, NULL);
+
     return table;
 }
 
-static void ctCodingTable_aux(const CodingTree* tree, BinarySequence** table,
+static void ctCodingTable_aux(const CodingTree* tree, uint16_t node,
+                              BinarySequence** table,
                               BinarySequence* bin_seq) {
     if (tree == NULL || table == NULL) return;
 
+    const Node* current = &tree->nodes[node];
     // Reached a leaf
-    if (tree->left == NULL && tree->right == NULL) {
-        char c = tree->character;
+    if (current->left == NO_CHILD) {
+        char c = current->character;
         table[(size_t) c] = bin_seq;
     } else {
         BinarySequence* left_seq = bin_seq == NULL ? biseCreate() :
                                    biseCopy(bin_seq);
         biseAddBit(left_seq, ZERO);
-        ctCodingTable_aux(tree->left, table, left_seq);
+        ctCodingTable_aux(tree, current->left, table, left_seq);
 
         BinarySequence* right_seq = bin_seq == NULL ? biseCreate() :
                                     biseCopy(bin_seq);
         biseAddBit(right_seq, ONE);
-        ctCodingTable_aux(tree->right, table, right_seq);
+        ctCodingTable_aux(tree, current->right, table, right_seq);
         biseFree(bin_seq);
     }
 }
 
+bool ctPackedCodingTable(const CodingTree* tree, PackedCode* table) {
+    memset(table, 0, ASCII_SIZE * sizeof(PackedCode));
+    return ctPackedCodingTable_aux(tree, tree->root, table, 0, 0);
+}
+
+static bool ctPackedCodingTable_aux(const CodingTree* tree, uint16_t node,
+                                    PackedCode* table, uint64_t code,
+                                    size_t length) {
+    const Node* current = &tree->nodes[node];
+    // Reached a leaf
+    if (current->left == NO_CHILD) {
+        table[(size_t) current->character] = ctPackCode(code, length);
+        return true;
+    }
+
+    if (length == CT_MAX_PACKED_LENGTH) {
+        return false;
+    }
+    return ctPackedCodingTable_aux(tree, current->left, table, code << 1,
+                                   length + 1)
+           && ctPackedCodingTable_aux(tree, current->right, table,
+                                      (code << 1) | 1, length + 1);
+}
+
+bool ctCodeLengths(const CodingTree* tree, unsigned char* lengths) {
+    PackedCode table[ASCII_SIZE];
+    if (!ctPackedCodingTable(tree, table)) {
+        return false;
+    }
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        lengths[c] = (unsigned char) ctCodeLength(table[c]);
+    }
+    return true;
+}
+
+bool ctCanonicalCodingTable(const unsigned char* lengths, PackedCode* table) {
+    size_t count[CT_MAX_PACKED_LENGTH + 1] = {0};
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        if (lengths[c] > CT_MAX_PACKED_LENGTH) {
+            return false;
+        }
+        count[lengths[c]]++;
+    }
+    count[0] = 0;
+
+    // First code of each length
+    uint64_t next[CT_MAX_PACKED_LENGTH + 1];
+    uint64_t code = 0;
+    for (size_t length = 1; length <= CT_MAX_PACKED_LENGTH; length++) {
+        code = (code + count[length - 1]) << 1;
+        next[length] = code;
+        // More codes of this length than there is room left
+        if (count[length] > (((uint64_t) 1) << length) - code) {
+            return false;
+        }
+    }
+
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        table[c] = lengths[c] ? ctPackCode(next[lengths[c]]++, lengths[c]) : 0;
+    }
+    return true;
+}
+
+bool ctWriteCodeLengths(BitWriter* writer, const unsigned char* lengths) {
+    unsigned char max_length = 0;
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        if (lengths[c] > max_length) {
+            max_length = lengths[c];
+        }
+    }
+    size_t width = 1;
+    while ((1u << width) <= max_length) {
+        width++;
+    }
+
+    bool success = biseWriteBits(writer, width, LENGTH_WIDTH_BITS);
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        success &= biseWriteBits(writer, lengths[c], width);
+    }
+    return success;
+}
+
+bool ctReadCodeLengths(BitReader* reader, unsigned char* lengths) {
+    size_t width = (size_t) biseReaderPeek(reader, LENGTH_WIDTH_BITS);
+    biseReaderConsume(reader, LENGTH_WIDTH_BITS);
+    if (width == 0 || width > LENGTH_WIDTH_BITS) {
+        return false;
+    }
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        lengths[c] = (unsigned char) biseReaderPeek(reader, width);
+        biseReaderConsume(reader, width);
+    }
+    return biseReaderTell(reader) <= reader->n_bits;
+}
+
 /* ------------------------------------------------------------------------- *
  * Decode a SINGLE binary code into a SINGLE character
  *
@@ -147,23 +531,27 @@ static void ctCodingTable_aux(const CodingTree* tree, BinarySequence** table,
  * ------------------------------------------------------------------------- */
 Decoded ctDecode(const CodingTree* tree, const BinarySequence* encodedSequence,
                  size_t start) {
-    Binary bin;
-    size_t offset = 0;
-    const CodingTree* node = tree;
-
-    while (node->left != NULL && node->right != NULL) {
-        bin = biseGetBit(encodedSequence, start + offset);
-        if (bin == ZERO) {
-            node = node->left;
-        } else if (bin == ONE) {
-            node = node->right;
+    BitReader reader;
+    biseReaderInit(&reader, encodedSequence, start);
+    return ctDecodeNext(tree, &reader);
+}
+
+Decoded ctDecodeNext(const CodingTree* tree, BitReader* reader) {
+    const Node* nodes = tree->nodes;
+    uint16_t node = tree->root;
+
+    while (nodes[node].left != NO_CHILD) {
+        if (biseReaderPeek(reader, 1)) {
+            node = nodes[node].right;
+        } else {
+            node = nodes[node].left;
         }
-        offset++;
+        biseReaderConsume(reader, 1);
     }
 
     Decoded decoded;
-    decoded.nextBit = start + offset;
-    decoded.character = node->character;
+    decoded.nextBit = biseReaderTell(reader);
+    decoded.character = nodes[node].character;
 
     return decoded;
 }
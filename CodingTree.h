@@ -5,12 +5,16 @@
  * - Leaves at the same depth must be ordered by increasing frequency from
  *   left to right (as in Figure 1(b) of the statement).
  * - Going left correspond to `0`, going right correspond to `1`.
+ * - The nodes of a tree are stored in a single array allocated with the
+ *   tree, children being referred to by their index.
  * ========================================================================= */
 
 #ifndef _CODING_TREE_H_
 #define _CODING_TREE_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #include "BinarySequence.h"
 
@@ -22,12 +26,25 @@ typedef struct decoded_t {
     size_t nextBit;
 } Decoded;
 
+/* A code packed in a single word: the code itself, right-aligned, in the
+ * upper bits and its length in the `CT_LENGTH_BITS` lower bits. */
+typedef uint64_t PackedCode;
+
+#define CT_LENGTH_BITS 6
+#define CT_MAX_PACKED_LENGTH 57
+#define ctPackCode(bits, length) \
+    ((((PackedCode) (bits)) << CT_LENGTH_BITS) | (PackedCode) (length))
+#define ctCodeBits(code) ((uint64_t) ((code) >> CT_LENGTH_BITS))
+#define ctCodeLength(code) \
+    ((size_t) ((code) & ((1 << CT_LENGTH_BITS) - 1)))
+
 /* ------------------------------------------------------------------------- *
  * Build a coding tree which only containts one leaf.
  *
  * PARAMETERS
  * c            The char to store
- * freqency     The frequency associated to the char is some given language
+ * freqency     The frequency associated to the char is some given language.
+ *              It is only needed to build the tree and is not stored.
  *
  * NOTE
  * The returned structure should be cleaned with `ctFree` after usage.
@@ -45,6 +62,10 @@ CodingTree* ctCreateLeaf(char c, double frequency);
  * leftTree     The first coding tree
  * rightTree    The second coding tree
  *
+ * NOTE
+ * The nodes of both trees are copied in the resulting tree, which is
+ * allocated at once. Both trees are freed, unless an error occurs.
+ *
  * RETURN
  * tree         The resulting tree, or NULL in case of error
  * ------------------------------------------------------------------------- */
@@ -75,6 +96,82 @@ void ctFree(CodingTree* tree);
  * ------------------------------------------------------------------------- */
 CodingTree* ctHuffman(const double* frequencies);
 
+/* ------------------------------------------------------------------------- *
+ * Compute the Huffman code lengths in linear time once the characters are
+ * sorted by frequency, with the two-queue method: no priority queue and no
+ * memory allocation.
+ *
+ * PARAMETERS
+ * frequencies  An array of size 127, such that frequencies[i] is the frequency
+ *              of the ith ascii character
+ * skipAbsent   Whether characters with zero frequency are left out of the
+ *              code (zero length) instead of being given a code
+ * lengths      An array of size 127 to fill with the code lengths
+ *
+ * RETURN
+ * success      True on success, false if no character is coded or if some
+ *              code is longer than CT_MAX_PACKED_LENGTH bits
+ * ------------------------------------------------------------------------- */
+bool ctHuffmanCodeLengths(const double* frequencies, bool skipAbsent,
+                          unsigned char* lengths);
+
+/* ------------------------------------------------------------------------- *
+ * Create an optimal coding tree without priority queue. The codes of the
+ * tree are the canonical codes of the lengths given by
+ * `ctHuffmanCodeLengths`, so they may differ from those of `ctHuffman`
+ * when frequencies are equal.
+ *
+ * PARAMETERS
+ * frequencies  An array of size 127, such that frequencies[i] is the frequency
+ *              of the ith ascii character
+ * skipAbsent   Whether characters with zero frequency are left out of the
+ *              tree
+ *
+ * RETURN
+ * tree         The coding tree, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+CodingTree* ctHuffmanLinear(const double* frequencies, bool skipAbsent);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the optimal code lengths such that no code is longer than
+ * `maxLength` bits, with the package-merge algorithm.
+ *
+ * PARAMETERS
+ * frequencies  An array of size 127, such that frequencies[i] is the frequency
+ *              of the ith ascii character
+ * maxLength    The maximum length of a code, at least 7 so that the 127
+ *              characters fit and at most CT_MAX_PACKED_LENGTH
+ * lengths      An array of size 127 to fill with the code lengths
+ *
+ * NOTE
+ * Characters with zero frequency are given a code as well
+ *
+ * RETURN
+ * success      True on success, false on error or if `maxLength` is out of
+ *              range
+ * ------------------------------------------------------------------------- */
+bool ctLimitedCodeLengths(const double* frequencies, size_t maxLength,
+                          unsigned char* lengths);
+
+/* ------------------------------------------------------------------------- *
+ * Create the optimal coding tree whose codes are at most `maxLength` bits
+ * long. The codes of the tree are the canonical codes of the lengths given
+ * by `ctLimitedCodeLengths`.
+ *
+ * PARAMETERS
+ * frequencies  An array of size 127, such that frequencies[i] is the frequency
+ *              of the ith ascii character
+ * maxLength    The maximum length of a code (see `ctLimitedCodeLengths`)
+ *
+ * NOTE
+ * With `maxLength` at most DT_PRIMARY_BITS, every code is decoded by a
+ * single lookup in the primary decoding table.
+ *
+ * RETURN
+ * tree         The coding tree, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+CodingTree* ctHuffmanLimited(const double* frequencies, size_t maxLength);
+
 
 /* ------------------------------------------------------------------------- *
  * Return an array of size 127 which maps ascii character their corresponding
@@ -93,6 +190,78 @@ CodingTree* ctHuffman(const double* frequencies);
  * ------------------------------------------------------------------------- */
 BinarySequence** ctCodingTable(const CodingTree* tree);
 
+/* ------------------------------------------------------------------------- *
+ * Fill an array of size 127 which maps ascii characters to their packed
+ * code. No memory is allocated.
+ *
+ * PARAMETERS
+ * tree     The coding tree
+ * table    An array of size 127 to fill. Characters absent from the tree
+ *          are given an empty code.
+ *
+ * RETURN
+ * success  True on success, false if some code is longer than
+ *          CT_MAX_PACKED_LENGTH bits
+ * ------------------------------------------------------------------------- */
+bool ctPackedCodingTable(const CodingTree* tree, PackedCode* table);
+
+/* ------------------------------------------------------------------------- *
+ * Fill an array of size 127 with the length of the code of each ascii
+ * character, i.e. the depth of its leaf in the tree.
+ *
+ * PARAMETERS
+ * tree     The coding tree
+ * lengths  An array of size 127 to fill. Characters absent from the tree
+ *          are given a zero length.
+ *
+ * RETURN
+ * success  True on success, false if some code is longer than
+ *          CT_MAX_PACKED_LENGTH bits
+ * ------------------------------------------------------------------------- */
+bool ctCodeLengths(const CodingTree* tree, unsigned char* lengths);
+
+/* ------------------------------------------------------------------------- *
+ * Fill an array of size 127 with the canonical codes corresponding to the
+ * given code lengths: codes of the same length are consecutive integers
+ * ordered by character, and shorter codes come before longer ones. The
+ * code is therefore entirely described by its lengths.
+ *
+ * PARAMETERS
+ * lengths  An array of size 127 with the code length of each character,
+ *          zero for absent characters
+ * table    An array of size 127 to fill with the packed codes
+ *
+ * RETURN
+ * success  True on success, false if the lengths do not describe a prefix
+ *          code or if some length exceeds CT_MAX_PACKED_LENGTH
+ * ------------------------------------------------------------------------- */
+bool ctCanonicalCodingTable(const unsigned char* lengths, PackedCode* table);
+
+/* ------------------------------------------------------------------------- *
+ * Write code lengths in a compact form: the number of bits of each length
+ * on 6 bits, followed by the 127 lengths.
+ *
+ * PARAMETERS
+ * writer   A valid pointer to the bit writer
+ * lengths  An array of size 127 with the code length of each character
+ *
+ * RETURN
+ * success  True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool ctWriteCodeLengths(BitWriter* writer, const unsigned char* lengths);
+
+/* ------------------------------------------------------------------------- *
+ * Read code lengths written by `ctWriteCodeLengths`.
+ *
+ * PARAMETERS
+ * reader   A valid pointer to the bit reader
+ * lengths  An array of size 127 to fill
+ *
+ * RETURN
+ * success  True on success, false if the input is too short
+ * ------------------------------------------------------------------------- */
+bool ctReadCodeLengths(BitReader* reader, unsigned char* lengths);
+
 /* ------------------------------------------------------------------------- *
  * Decode a SINGLE binary code into a SINGLE character
  *
@@ -108,5 +277,18 @@ BinarySequence** ctCodingTable(const CodingTree* tree);
 Decoded ctDecode(const CodingTree* tree, const BinarySequence* encodedSequence,
                  size_t start);
 
+/* ------------------------------------------------------------------------- *
+ * Decode the next character read by a bit reader, consuming its code.
+ *
+ * PARAMETERS
+ * tree             The conding tree
+ * reader           The bit reader, positioned at the start of a code
+ *
+ * RETURN
+ * decoded A structure containing the decoded character and the index of the
+ *         next bit to read for the next character decoding.
+ * ------------------------------------------------------------------------- */
+Decoded ctDecodeNext(const CodingTree* tree, BitReader* reader);
+
 
 #endif // _CODING_TREE_H_
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "ContextCoding.h"
+#include "coding.h"
+#include "DecodingTable.h"
+
+static const size_t ASCII_SIZE = 127;
+
+/**
+ * Counts the pairs of consecutive ascii characters of a text, the first one
+ * following CC_START.
+ * @param source The text
+ * @param counts An array of size 127 * 127, counts[p * 127 + c] being set to
+ * the number of characters c following the character p
+ */
+static void countPairs(const CharVector* source, size_t* counts) {
+    memset(counts, 0, ASCII_SIZE * ASCII_SIZE * sizeof(size_t));
+    size_t previous = CC_START;
+    for (size_t i = 0; i < cvSize(source); i++) {
+        char c = cvGet(source, i);
+        if (c < 0 || c >= 127) // Filtering out non-ascii
+            continue;
+        counts[previous * ASCII_SIZE + (size_t) c]++;
+        previous = (size_t) c;
+    }
+}
+
+/**
+ * Computes the code lengths and the canonical codes of every context.
+ * @param counts The pair counts given by `countPairs`
+ * @param lengths An array of size 127 * 127 to fill with the code lengths of
+ * each context, all zero for the contexts followed by no character
+ * @param codes An array of size 127 * 127 to fill with the packed codes
+ * @param used An array of size 127 telling whether each context is followed
+ * by some character
+ * @return true on success, false if some code is too long
+ */
+static bool contextCodes(const size_t* counts, unsigned char* lengths,
+                         PackedCode* codes, bool* used) {
+    bool success = true;
+    for (size_t p = 0; success && p < ASCII_SIZE; p++) {
+        double frequencies[ASCII_SIZE];
+        used[p] = false;
+        for (size_t c = 0; c < ASCII_SIZE; c++) {
+            frequencies[c] = (double) counts[p * ASCII_SIZE + c];
+            used[p] |= counts[p * ASCII_SIZE + c] > 0;
+        }
+        memset(lengths + p * ASCII_SIZE, 0, ASCII_SIZE);
+        memset(codes + p * ASCII_SIZE, 0, ASCII_SIZE * sizeof(PackedCode));
+        if (used[p]) {
+            success = ctHuffmanCodeLengths(frequencies, true,
+                                           lengths + p * ASCII_SIZE) &&
+                      ctCanonicalCodingTable(lengths + p * ASCII_SIZE,
+                                             codes + p * ASCII_SIZE);
+        }
+    }
+    return success;
+}
+
+bool encodeContext(const CharVector* source, BinarySequence* dest) {
+    size_t* counts = malloc(ASCII_SIZE * ASCII_SIZE * sizeof(size_t));
+    unsigned char* lengths = malloc(ASCII_SIZE * ASCII_SIZE);
+    PackedCode* codes = malloc(ASCII_SIZE * ASCII_SIZE * sizeof(PackedCode));
+    bool used[ASCII_SIZE];
+    bool success = counts && lengths && codes;
+    if (success) {
+        countPairs(source, counts);
+        success = contextCodes(counts, lengths, codes, used);
+    }
+
+    TextHeader header = {TEXT_CONTEXT, 0, 0};
+    for (size_t i = 0; success && i < ASCII_SIZE * ASCII_SIZE; i++) {
+        header.n_chars += counts[i];
+        header.n_bits += counts[i] * lengths[i];
+    }
+
+    BitWriter writer;
+    biseWriterInit(&writer, dest);
+    if (success) {
+        unsigned char bytes[TEXT_HEADER_SIZE];
+        writeTextHeader(&header, bytes);
+        for (size_t i = 0; i < TEXT_HEADER_SIZE; i++)
+            success &= biseWriteBits(&writer, bytes[i], 8);
+        for (size_t p = 0; p < ASCII_SIZE; p++)
+            success &= biseWriteBits(&writer, used[p], 1);
+        for (size_t p = 0; success && p < ASCII_SIZE; p++) {
+            if (used[p])
+                success = ctWriteCodeLengths(&writer,
+                                             lengths + p * ASCII_SIZE);
+        }
+    }
+
+    // The codes of a context are next to each other
+    const PackedCode* table = codes + CC_START * ASCII_SIZE;
+    for (size_t i = 0; success && i < cvSize(source); i++) {
+        char c = cvGet(source, i);
+        if (c < 0 || c >= 127) // Filtering out non-ascii
+            continue;
+        PackedCode code = table[(size_t) c];
+        success &= biseWriteBits(&writer, ctCodeBits(code),
+                                 ctCodeLength(code));
+        table = codes + (size_t) c * ASCII_SIZE;
+    }
+    success = success && biseWriterFlush(&writer);
+
+    free(counts);
+    free(lengths);
+    free(codes);
+    return success;
+}
+
+bool decodeContext(const BinarySequence* source, CharVector* dest) {
+    if (dest == NULL || biseGetNumberOfBytes(source) < TEXT_HEADER_SIZE)
+        return false;
+
+    unsigned char bytes[TEXT_HEADER_SIZE];
+    for (size_t i = 0; i < TEXT_HEADER_SIZE; i++)
+        bytes[i] = biseGetByte(source, i, ZERO);
+    TextHeader header;
+    if (!readTextHeader(bytes, TEXT_HEADER_SIZE, &header) ||
+        header.flags != TEXT_CONTEXT)
+        return false;
+
+    BitReader reader;
+    biseReaderInit(&reader, source, 8 * TEXT_HEADER_SIZE);
+    bool used[ASCII_SIZE];
+    for (size_t p = 0; p < ASCII_SIZE; p++) {
+        used[p] = biseReaderPeek(&reader, 1);
+        biseReaderConsume(&reader, 1);
+    }
+
+    // A decoding table per context, NULL for the unused ones
+    DecodingTable* tables[ASCII_SIZE];
+    memset(tables, 0, sizeof(tables));
+    bool success = true;
+    for (size_t p = 0; success && p < ASCII_SIZE; p++) {
+        unsigned char lengths[ASCII_SIZE];
+        PackedCode codes[ASCII_SIZE];
+        if (used[p])
+            success = ctReadCodeLengths(&reader, lengths) &&
+                      ctCanonicalCodingTable(lengths, codes) &&
+                      (tables[p] = dtCreate(codes)) != NULL;
+    }
+
+    size_t start = biseReaderTell(&reader);
+    success = success && start <= biseGetNumberOfBits(source) &&
+              biseGetNumberOfBits(source) - start >= header.n_bits;
+    char* chars = success ? cvExtend(dest, header.n_chars) : NULL;
+    success = success && chars;
+
+    // Each character chooses the table of the next one, which only the last
+    // character may not have
+    const DecodingTable* table = tables[(size_t) CC_START];
+    success = success && (table || header.n_chars == 0);
+    for (size_t i = 0; success && i < header.n_chars; i++) {
+        size_t current_bit = biseReaderTell(&reader);
+        Decoded d = dtDecodeNext(table, &reader);
+        chars[i] = d.character;
+        table = tables[(unsigned char) d.character];
+        success = d.nextBit != current_bit &&
+                  (table || i + 1 == header.n_chars);
+    }
+    success = success && biseReaderTell(&reader) == start + header.n_bits;
+
+    for (size_t p = 0; p < ASCII_SIZE; p++)
+        dtFree(tables[p]);
+    return success;
+}
@@ -0,0 +1,57 @@
+/* ========================================================================= *
+ * Order-1 context coding interface.
+ *
+ * Each character is encoded with a code chosen by the character before it,
+ * its context: in a text, the character following a 'q' or a space is much
+ * more predictable than any character. The 127 codes are the Huffman codes
+ * of the pairs of consecutive characters counted in the text itself, so no
+ * CSV is needed. The first character is encoded in the context CC_START.
+ *
+ * FORMAT
+ * The header of coding.h with TEXT_CONTEXT, followed by:
+ * - For each of the 127 contexts, 1 bit set if some character follows it
+ * - The code lengths of each of these contexts, as written by
+ *   `ctWriteCodeLengths`, in the order of the contexts
+ * - The encoded characters, padded to a whole byte
+ * ========================================================================= */
+
+#ifndef _CONTEXT_CODING_H_
+#define _CONTEXT_CODING_H_
+
+#include <stdbool.h>
+
+#include "BinarySequence.h"
+#include "CharVector.h"
+
+/* Context of the first character, as if the text followed a newline */
+#define CC_START '\n'
+
+/* ------------------------------------------------------------------------- *
+ * Encode an ascii encoded text with the codes of its order-1 contexts.
+ * Non-ascii characters are filtered out, as in `encode`.
+ *
+ * PARAMETERS
+ * source     A vector containing the characters to encode.
+ * dest       A binary sequence where to write the header, the code lengths
+ *            and the encoded text.
+ *
+ * RETURN
+ * success    True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool encodeContext(const CharVector* source, BinarySequence* dest);
+
+/* ------------------------------------------------------------------------- *
+ * Decode a text encoded by `encodeContext`.
+ *
+ * PARAMETERS
+ * source     A binary sequence containing the header, the code lengths and
+ *            the encoded text.
+ * dest       A vector where to write the decoded characters.
+ *
+ * RETURN
+ * success    True on success, false on error or if the sequence is not a
+ *            valid text encoded by contexts
+ * ------------------------------------------------------------------------- */
+bool decodeContext(const BinarySequence* source, CharVector* dest);
+
+#endif // _CONTEXT_CODING_H_
@@ -0,0 +1,421 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "DecodingTable.h"
+
+static const size_t ASCII_SIZE = 127;
+static const size_t MAX_ENTRIES = UINT16_MAX;
+static const size_t BUILD_ERROR = (size_t) -1;
+
+static inline uint64_t mask(size_t n_bits) {
+    return (((uint64_t) 1) << n_bits) - 1;
+}
+
+/**
+ * Appends `size` empty entries at the end of the table.
+ * @param table The decoding table
+ * @param size The number of entries to append
+ * @return true on success, false on error
+ */
+static bool reserve(DecodingTable* table, size_t size) {
+    if (table->n_entries + size > MAX_ENTRIES) {
+        return false;
+    }
+    if (table->n_entries + size > table->capacity) {
+        size_t new_capacity = 2 * (table->n_entries + size);
+        DtEntry* new_entries = realloc(table->entries,
+                                       new_capacity * sizeof(DtEntry));
+        if (!new_entries) {
+            return false;
+        }
+        table->entries = new_entries;
+        table->capacity = new_capacity;
+    }
+    memset(table->entries + table->n_entries, 0, size * sizeof(DtEntry));
+    table->n_entries += size;
+    return true;
+}
+
+/**
+ * Builds the (sub-)table resolving the given characters, all of which share
+ * the same `depth` first bits, using the `bits` following ones as index.
+ * Longer codes are resolved recursively by secondary tables.
+ * @param table The decoding table
+ * @param codes The codes of all the characters, right-aligned
+ * @param lengths The code lengths of all the characters
+ * @param chars The characters to resolve in this (sub-)table
+ * @param n_chars The number of characters to resolve
+ * @param depth The number of bits already consumed
+ * @param bits The number of bits indexing this (sub-)table
+ * @return the index of the first entry of the (sub-)table, or BUILD_ERROR
+ */
+static size_t build_level(DecodingTable* table, const uint64_t* codes,
+                          const size_t* lengths, const unsigned char* chars,
+                          size_t n_chars, size_t depth, size_t bits) {
+    size_t base = table->n_entries;
+    if (!reserve(table, ((size_t) 1) << bits)) {
+        return BUILD_ERROR;
+    }
+    size_t end = depth + bits;
+
+    // Codes ending in this table fill every entry they are a prefix of
+    for (size_t i = 0; i < n_chars; i++) {
+        unsigned char c = chars[i];
+        if (lengths[c] > end) {
+            continue;
+        }
+        size_t first = (codes[c] & mask(lengths[c] - depth))
+                       << (end - lengths[c]);
+        size_t count = ((size_t) 1) << (end - lengths[c]);
+        for (size_t k = 0; k < count; k++) {
+            DtEntry* entry = &table->entries[base + first + k];
+            entry->value = c;
+            entry->length = (uint8_t) lengths[c];
+        }
+    }
+
+    // Longer codes are grouped by index and resolved one level further
+    unsigned char group[ASCII_SIZE];
+    for (size_t i = 0; i < n_chars; i++) {
+        unsigned char c = chars[i];
+        if (lengths[c] <= end) {
+            continue;
+        }
+        size_t index = (codes[c] >> (lengths[c] - end)) & mask(bits);
+        if (table->entries[base + index].sub_bits) { // Group already built
+            continue;
+        }
+
+        size_t n_group = 0, group_length = 0;
+        for (size_t j = i; j < n_chars; j++) {
+            unsigned char d = chars[j];
+            if (lengths[d] > end &&
+                ((codes[d] >> (lengths[d] - end)) & mask(bits)) == index) {
+                group[n_group++] = d;
+                if (lengths[d] > group_length) {
+                    group_length = lengths[d];
+                }
+            }
+        }
+
+        size_t sub_bits = group_length - end;
+        if (sub_bits > DT_SECONDARY_BITS) {
+            sub_bits = DT_SECONDARY_BITS;
+        }
+        size_t sub_base = build_level(table, codes, lengths, group, n_group,
+                                      end, sub_bits);
+        if (sub_base == BUILD_ERROR) {
+            return BUILD_ERROR;
+        }
+        DtEntry* link = &table->entries[base + index];
+        link->value = (uint16_t) sub_base;
+        link->length = 0;
+        link->sub_bits = (uint8_t) sub_bits;
+    }
+
+    return base;
+}
+
+/**
+ * Builds the multi-symbol table of a decoding table from its primary table.
+ * @param table The decoding table, without multi-symbol table
+ * @return true on success, false on error
+ */
+static bool build_multi(DecodingTable* table) {
+    size_t bits = table->primary_bits;
+    DtMultiEntry* multi = calloc(((size_t) 1) << bits, sizeof(DtMultiEntry));
+    if (!multi) {
+        return false;
+    }
+
+    // Successive codes of each index, looked up with the remaining bits
+    // followed by zeros, as long as they end within the index
+    for (size_t index = 0; index < (((size_t) 1) << bits); index++) {
+        DtMultiEntry* entry = &multi[index];
+        size_t consumed = 0;
+        while (entry->n_chars < DT_MULTI_CHARS) {
+            DtEntry code = table->entries[(index << consumed) & mask(bits)];
+            if (code.sub_bits || code.length == 0 ||
+                code.length > bits - consumed) {
+                break;
+            }
+            entry->chars[entry->n_chars++] = (char) code.value;
+            consumed += code.length;
+        }
+        entry->length = (uint8_t) consumed;
+    }
+
+    table->multi = multi;
+    return true;
+}
+
+DecodingTable* dtCreate(const PackedCode* codes) {
+    if (!codes) {
+        return NULL;
+    }
+
+    uint64_t values[ASCII_SIZE];
+    size_t lengths[ASCII_SIZE];
+    unsigned char chars[ASCII_SIZE];
+    size_t n_chars = 0, max_length = 0;
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        lengths[c] = ctCodeLength(codes[c]);
+        if (lengths[c] == 0) { // Character absent from the tree
+            continue;
+        }
+        if (lengths[c] > DT_MAX_CODE_LENGTH) {
+            return NULL;
+        }
+        values[c] = ctCodeBits(codes[c]);
+        chars[n_chars++] = (unsigned char) c;
+        if (lengths[c] > max_length) {
+            max_length = lengths[c];
+        }
+    }
+    if (n_chars == 0) {
+        return NULL;
+    }
+
+    DecodingTable* table = malloc(sizeof(DecodingTable));
+    if (!table) {
+        return NULL;
+    }
+    table->entries = NULL;
+    table->n_entries = 0;
+    table->capacity = 0;
+    table->multi = NULL;
+    table->max_length = max_length;
+    table->primary_bits = max_length < DT_PRIMARY_BITS ?
+                          max_length : DT_PRIMARY_BITS;
+
+    if (build_level(table, values, lengths, chars, n_chars, 0,
+                    table->primary_bits) == BUILD_ERROR ||
+        !build_multi(table)) {
+        dtFree(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+DecodingTable* dtFromEntries(const DtEntry* entries, size_t n_entries,
+                             size_t primary_bits, size_t max_length) {
+    if (!entries || primary_bits == 0 || primary_bits > DT_PRIMARY_BITS ||
+        n_entries < (((size_t) 1) << primary_bits)) {
+        return NULL;
+    }
+    DecodingTable* table = malloc(sizeof(DecodingTable));
+    if (!table) {
+        return NULL;
+    }
+    // No capacity: the entries are not owned, never written nor freed
+    table->entries = (DtEntry*) entries;
+    table->n_entries = n_entries;
+    table->capacity = 0;
+    table->primary_bits = primary_bits;
+    table->max_length = max_length;
+    table->multi = NULL;
+    if (!build_multi(table)) {
+        dtFree(table);
+        return NULL;
+    }
+    return table;
+}
+
+const DtEntry* dtEntries(const DecodingTable* table, size_t* n_entries,
+                         size_t* primary_bits) {
+    *n_entries = table->n_entries;
+    *primary_bits = table->primary_bits;
+    return table->entries;
+}
+
+void dtFree(DecodingTable* table) {
+    if (!table) {
+        return;
+    }
+    if (table->capacity > 0) {
+        free(table->entries);
+    }
+    free(table->multi);
+    free(table);
+}
+
+size_t dtMaxCodeLength(const DecodingTable* table) {
+    return table->max_length;
+}
+
+bool dtWriteSource(const DecodingTable* table, const char* name, FILE* file) {
+    fprintf(file, "static const DtEntry %s_entries[%zu] = {", name,
+            table->n_entries);
+    for (size_t i = 0; i < table->n_entries; i++) {
+        const DtEntry* entry = &table->entries[i];
+        fprintf(file, "%s{%u, %u, %u},", i % 6 ? " " : "\n    ",
+                (unsigned) entry->value, (unsigned) entry->length,
+                (unsigned) entry->sub_bits);
+    }
+    fprintf(file, "\n};\n\n");
+
+    size_t n_multi = table->multi ? ((size_t) 1) << table->primary_bits : 0;
+    if (n_multi) {
+        fprintf(file, "static const DtMultiEntry %s_multi[%zu] = {", name,
+                n_multi);
+        for (size_t i = 0; i < n_multi; i++) {
+            const DtMultiEntry* entry = &table->multi[i];
+            fprintf(file, "%s{{", i % 3 ? " " : "\n    ");
+            for (size_t c = 0; c < DT_MULTI_CHARS; c++) {
+                fprintf(file, "%s%d", c ? ", " : "", entry->chars[c]);
+            }
+            fprintf(file, "}, %u, %u},", (unsigned) entry->n_chars,
+                    (unsigned) entry->length);
+        }
+        fprintf(file, "\n};\n\n");
+    }
+
+    // The entries are never written through the table, hence the casts
+    fprintf(file, "static const DecodingTable %s_table = {\n"
+                  "    (DtEntry*) %s_entries, %zu, 0, %zu, %zu,\n",
+            name, name, table->n_entries, table->primary_bits,
+            table->max_length);
+    if (n_multi) {
+        fprintf(file, "    (DtMultiEntry*) %s_multi\n};\n\n", name);
+    } else {
+        fprintf(file, "    NULL\n};\n\n");
+    }
+
+    return !ferror(file);
+}
+
+Decoded dtDecode(const DecodingTable* table,
+                 const BinarySequence* encodedSequence, size_t start) {
+    BitReader reader;
+    biseReaderInit(&reader, encodedSequence, start);
+    return dtDecodeNext(table, &reader);
+}
+
+/**
+ * Looks up the code at the position of the reader and consumes it.
+ * @param table The decoding table
+ * @param reader The bit reader
+ * @return the entry of the code, whose length is 0 if no code matches
+ */
+static inline DtEntry lookup(const DecodingTable* table, BitReader* reader) {
+    // The longest code fits in the window, so one peek resolves any code
+    uint64_t window = biseReaderPeek(reader, table->max_length);
+
+    size_t consumed = table->primary_bits;
+    DtEntry entry = table->entries[window >> (table->max_length - consumed)];
+    while (entry.sub_bits) {
+        consumed += entry.sub_bits;
+        size_t index = (window >> (table->max_length - consumed)) &
+                       mask(entry.sub_bits);
+        entry = table->entries[entry.value + index];
+    }
+    biseReaderConsume(reader, entry.length);
+    return entry;
+}
+
+Decoded dtDecodeNext(const DecodingTable* table, BitReader* reader) {
+    DtEntry entry = lookup(table, reader);
+
+    Decoded decoded;
+    decoded.character = (char) entry.value;
+    decoded.nextBit = biseReaderTell(reader);
+
+    return decoded;
+}
+
+bool dtDecodeInterleaved(const DecodingTable* table, BitReader* readers,
+                         char** dests, size_t n_chars) {
+    // Errors are only checked at the end to keep the loop branch free
+    bool unmatched = false;
+    for (size_t i = 0; i < n_chars; i++) {
+        DtEntry e0 = lookup(table, &readers[0]);
+        DtEntry e1 = lookup(table, &readers[1]);
+        DtEntry e2 = lookup(table, &readers[2]);
+        DtEntry e3 = lookup(table, &readers[3]);
+        dests[0][i] = (char) e0.value;
+        dests[1][i] = (char) e1.value;
+        dests[2][i] = (char) e2.value;
+        dests[3][i] = (char) e3.value;
+        unmatched |= !e0.length | !e1.length | !e2.length | !e3.length;
+    }
+
+    bool success = !unmatched;
+    for (size_t s = 0; s < DT_STREAMS; s++) {
+        success &= biseReaderTell(&readers[s]) <= readers[s].n_bits;
+    }
+    return success;
+}
+
+bool dtDecodeCounted(const DecodingTable* table, BitReader* reader,
+                     char* dest, size_t n_chars) {
+    // Errors are only checked at the end to keep the loop branch free, the
+    // reader reading zeros past the end of the input
+    bool unmatched = false;
+    size_t i = 0;
+
+    // Several characters per lookup while they fit in dest, one through the
+    // decoding table when the first code is longer than the index
+    const DtMultiEntry* multi = table->multi;
+    size_t bits = table->primary_bits;
+    while (multi && i + DT_MULTI_CHARS <= n_chars) {
+        DtMultiEntry entry = multi[biseReaderPeek(reader, bits)];
+        if (entry.n_chars) {
+            memcpy(dest + i, entry.chars, DT_MULTI_CHARS);
+            biseReaderConsume(reader, entry.length);
+            i += entry.n_chars;
+        } else {
+            DtEntry code = lookup(table, reader);
+            unmatched |= !code.length;
+            dest[i++] = (char) code.value;
+        }
+    }
+
+    for (; i < n_chars; i++) {
+        DtEntry code = lookup(table, reader);
+        unmatched |= !code.length;
+        dest[i] = (char) code.value;
+    }
+
+    return !unmatched && biseReaderTell(reader) <= reader->n_bits;
+}
+
+bool dtDecodeChunk(const DecodingTable* table, BitReader* reader,
+                   size_t limit, char* dest, size_t capacity,
+                   size_t* n_decoded) {
+    size_t current_bit = biseReaderTell(reader);
+    size_t n = 0;
+    bool success = true;
+
+    const DtMultiEntry* multi = table->multi;
+    size_t bits = table->primary_bits;
+    while (current_bit < limit && n < capacity) {
+        // Several characters at once when all their codes are before the
+        // limit and they fit in dest
+        if (multi && current_bit + bits <= limit &&
+            n + DT_MULTI_CHARS <= capacity) {
+            DtMultiEntry entry = multi[biseReaderPeek(reader, bits)];
+            if (entry.n_chars) {
+                memcpy(dest + n, entry.chars, DT_MULTI_CHARS);
+                biseReaderConsume(reader, entry.length);
+                n += entry.n_chars;
+                current_bit += entry.length;
+                continue;
+            }
+        }
+
+        // The input ends in the middle of a code
+        DtEntry code = lookup(table, reader);
+        current_bit += code.length;
+        if (!code.length || current_bit > reader->n_bits) {
+            success = false;
+            break;
+        }
+
+        dest[n++] = (char) code.value;
+    }
+
+    *n_decoded = n;
+    return success;
+}
@@ -0,0 +1,258 @@
+/* ========================================================================= *
+ * Decoding table interface.
+ *
+ * NOTE
+ * - A decoding table resolves a whole code with a single lookup: the next
+ *   `DT_PRIMARY_BITS` bits of the encoded sequence index a primary table
+ *   whose entries hold the decoded character and the length of its code.
+ * - Codes longer than `DT_PRIMARY_BITS` are resolved through secondary
+ *   tables indexed by the following bits (at most `DT_SECONDARY_BITS` per
+ *   level).
+ * - When the codes are short, the bits indexing the primary table often
+ *   hold several whole codes. A multi-symbol table, indexed by the same
+ *   bits, gives all of them (up to `DT_MULTI_CHARS`) at once, so that
+ *   `dtDecodeCounted` and `dtDecodeChunk` decode several characters per
+ *   lookup.
+ * ========================================================================= */
+
+#ifndef _DECODING_TABLE_H_
+#define _DECODING_TABLE_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "BinarySequence.h"
+#include "CodingTree.h"
+
+/* Number of bits used to index the primary table */
+#define DT_PRIMARY_BITS 11
+
+/* Maximum number of bits used to index a secondary table */
+#define DT_SECONDARY_BITS 7
+
+/* Maximum length of a code supported by the decoding table */
+#define DT_MAX_CODE_LENGTH BISE_MAX_PEEK_BITS
+
+/* Number of streams decoded together by `dtDecodeInterleaved` */
+#define DT_STREAMS 4
+
+/* Maximum number of characters decoded by a multi-symbol entry */
+#define DT_MULTI_CHARS 4
+
+/* Entry of a decoding table */
+typedef struct dt_entry_t {
+    // Decoded character, or index of the secondary table for links.
+    uint16_t value;
+    // Length of the code, 0 for links.
+    uint8_t length;
+    // Number of bits indexing the secondary table, 0 for characters.
+    uint8_t sub_bits;
+} DtEntry;
+
+/* Entry of a multi-symbol table */
+typedef struct dt_multi_entry_t {
+    // Decoded characters, only the first `n_chars` ones being valid, so
+    // that they are all stored at once.
+    char chars[DT_MULTI_CHARS];
+    // Number of whole codes in the index, 0 if the first code is longer.
+    uint8_t n_chars;
+    // Total length of these codes.
+    uint8_t length;
+} DtMultiEntry;
+
+/* Only exposed for the tables generated by `dtWriteSource`, the fields should
+ * not be used otherwise. */
+typedef struct decoding_table_t {
+    // Primary table followed by all the secondary tables.
+    DtEntry* entries;
+    size_t n_entries;
+    // 0 for generated tables, whose entries are never written.
+    size_t capacity;
+
+    size_t primary_bits;
+    size_t max_length;
+
+    // Multi-symbol table, indexed like the primary table, or NULL.
+    DtMultiEntry* multi;
+} DecodingTable;
+
+/* ------------------------------------------------------------------------- *
+ * Build the decoding table corresponding to a coding table.
+ *
+ * PARAMETERS
+ * codes        An array of size 127 such that codes[i] is the packed code of
+ *              the ith ascii character (see `ctPackedCodingTable`), empty
+ *              codes being ignored
+ *
+ * NOTE
+ * The returned structure should be cleaned with `dtFree` after usage.
+ *
+ * RETURN
+ * table        The decoding table, or NULL in case of error or if some code
+ *              is longer than DT_MAX_CODE_LENGTH bits
+ * ------------------------------------------------------------------------- */
+DecodingTable* dtCreate(const PackedCode* codes);
+
+/* ------------------------------------------------------------------------- *
+ * Build a decoding table around entries stored elsewhere, e.g. mapped from a
+ * file, as returned by `dtEntries`. Only its multi-symbol table is built.
+ *
+ * PARAMETERS
+ * entries      The primary table followed by all the secondary tables, which
+ *              must outlive the decoding table and are never written
+ * n_entries    The number of entries
+ * primary_bits The number of bits indexing the primary table
+ * max_length   The length of the longest code
+ *
+ * NOTE
+ * The returned structure should be cleaned with `dtFree` after usage, which
+ * does not free the entries.
+ *
+ * RETURN
+ * table        The decoding table, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+DecodingTable* dtFromEntries(const DtEntry* entries, size_t n_entries,
+                             size_t primary_bits, size_t max_length);
+
+/* ------------------------------------------------------------------------- *
+ * Return the entries of a decoding table, e.g. to store them in a file and
+ * build the same table with `dtFromEntries`.
+ *
+ * PARAMETERS
+ * table        The decoding table
+ * n_entries    Where to store the number of entries
+ * primary_bits Where to store the number of bits indexing the primary table
+ *
+ * RETURN
+ * entries      The primary table followed by all the secondary tables
+ * ------------------------------------------------------------------------- */
+const DtEntry* dtEntries(const DecodingTable* table, size_t* n_entries,
+                         size_t* primary_bits);
+
+
+/* ------------------------------------------------------------------------- *
+ * Free the memory allocated for the decoding table.
+ *
+ * PARAMETERS
+ * table        The decoding table
+ * ------------------------------------------------------------------------- */
+void dtFree(DecodingTable* table);
+
+
+/* ------------------------------------------------------------------------- *
+ * Decode a SINGLE binary code into a SINGLE character
+ *
+ * PARAMETERS
+ * table            The decoding table
+ * encodedSequence  The code to decode
+ * start            The first bit to read to decode the character
+ *
+ * RETURN
+ * decoded A structure containing the decoded character and the index of the
+ *         next bit to read for the next character decoding. `nextBit` is
+ *         equal to `start` if no code matches the bits at `start`.
+ * ------------------------------------------------------------------------- */
+Decoded dtDecode(const DecodingTable* table,
+                 const BinarySequence* encodedSequence, size_t start);
+
+/* ------------------------------------------------------------------------- *
+ * Decode the next character read by a bit reader, consuming its code.
+ *
+ * PARAMETERS
+ * table            The decoding table
+ * reader           The bit reader, positioned at the start of a code
+ *
+ * RETURN
+ * decoded A structure containing the decoded character and the index of the
+ *         next bit to read for the next character decoding. Nothing is
+ *         consumed if no code matches the next bits.
+ * ------------------------------------------------------------------------- */
+Decoded dtDecodeNext(const DecodingTable* table, BitReader* reader);
+
+/* ------------------------------------------------------------------------- *
+ * Decode `n_chars` characters from each of DT_STREAMS independent streams.
+ * The streams are decoded in the same loop so that their lookups, which do
+ * not depend on each other, overlap.
+ *
+ * PARAMETERS
+ * table            The decoding table
+ * readers          DT_STREAMS bit readers, one per stream
+ * dests            DT_STREAMS arrays of size n_chars where to write the
+ *                  characters decoded from each stream
+ * n_chars          The number of characters to decode from each stream
+ *
+ * RETURN
+ * success          True on success, false if some bits do not match any
+ *                  code or if a code goes beyond the end of a stream
+ * ------------------------------------------------------------------------- */
+bool dtDecodeInterleaved(const DecodingTable* table, BitReader* readers,
+                         char** dests, size_t n_chars);
+
+/* ------------------------------------------------------------------------- *
+ * Decode exactly `n_chars` characters, without checking for the end of the
+ * input before each of them. Used by `decodeCounted`.
+ *
+ * PARAMETERS
+ * table            The decoding table
+ * reader           The bit reader, positioned at the start of a code
+ * dest             An array of size n_chars where to write the characters
+ * n_chars          The number of characters to decode
+ *
+ * RETURN
+ * success          True on success, false if some bits do not match any
+ *                  code or if a code goes beyond the end of the input
+ * ------------------------------------------------------------------------- */
+bool dtDecodeCounted(const DecodingTable* table, BitReader* reader,
+                     char* dest, size_t n_chars);
+
+/* ------------------------------------------------------------------------- *
+ * Decode the characters whose code starts before the bit `limit`, stopping
+ * early when `capacity` characters were decoded. Used by `decodeChunk`.
+ *
+ * PARAMETERS
+ * table            The decoding table
+ * reader           The bit reader, positioned at the start of a code
+ * limit            The index of the bit from which no code is decoded
+ * dest             An array of size capacity where to write the characters
+ * capacity         The maximum number of characters to decode
+ * n_decoded        Set to the number of decoded characters
+ *
+ * RETURN
+ * success          True on success, false if some bits do not match any
+ *                  code or if a code goes beyond the end of the input
+ * ------------------------------------------------------------------------- */
+bool dtDecodeChunk(const DecodingTable* table, BitReader* reader,
+                   size_t limit, char* dest, size_t capacity,
+                   size_t* n_decoded);
+
+/* ------------------------------------------------------------------------- *
+ * Return the length of the longest code of the decoding table, that is the
+ * maximum number of bits read to decode a character.
+ *
+ * PARAMETERS
+ * table            The decoding table
+ *
+ * RETURN
+ * length           The length of the longest code
+ * ------------------------------------------------------------------------- */
+size_t dtMaxCodeLength(const DecodingTable* table);
+
+/* ------------------------------------------------------------------------- *
+ * Write the C definition of a constant copy of the decoding table, named
+ * `<name>_table`, whose entries are named `<name>_entries`.
+ *
+ * PARAMETERS
+ * table            The decoding table
+ * name             The prefix of the names, a valid C identifier
+ * file             The file where to write the definitions
+ *
+ * NOTE
+ * The generated table must not be given to `dtFree`.
+ *
+ * RETURN
+ * success          True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool dtWriteSource(const DecodingTable* table, const char* name, FILE* file);
+
+#endif // _DECODING_TABLE_H_
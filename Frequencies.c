@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "Frequencies.h"
+
+static const size_t ASCII_SIZE = 127;
+static const size_t BUFFER_SIZE = 1024;
+
+double* fqFromCsv(const char* filepath) {
+    char buffer[BUFFER_SIZE];
+
+    FILE* fp = fopen(filepath, "r");
+    if (!fp)
+        return NULL;
+
+    double* frequencies = (double*) calloc(ASCII_SIZE, sizeof(double));
+    if (!frequencies) {
+        fclose(fp);
+        return NULL;
+    }
+
+    char character;
+    char* nextPart;
+
+    // Read line by line
+    while (fgets(buffer, BUFFER_SIZE, fp)) {
+        // Parse char and frequency
+        character = (char) strtol(buffer, &nextPart, 10);
+        if (buffer == nextPart) // Could not parse char ascii code
+        {
+            free(frequencies);
+            fclose(fp);
+            return NULL;
+        }
+
+        while (!isdigit(*nextPart) &&
+               (*nextPart) != '.') // Skip space and comma
+            nextPart++;
+
+        frequencies[(size_t) character] = strtod(nextPart, NULL);;
+    }
+
+
+    fclose(fp);
+    return frequencies;
+}
@@ -0,0 +1,30 @@
+/* ========================================================================= *
+ * Character frequencies interface.
+ * ========================================================================= */
+
+#ifndef _FREQUENCIES_H_
+#define _FREQUENCIES_H_
+
+/* ------------------------------------------------------------------------- *
+ * Parse a ascii frequency csv file.
+ *
+ * CSV STRUCTURE
+ * Each line is a pair ascii code (in integer format)-frequency, separated
+ * by a comma. There is no additionnal space before and/or after the code,
+ * the comma or the frequency. The frequency is expressed as a double between
+ * 0 and 1.
+ * Only one blank line at the end of the file is allowed.
+ *
+ * PARAMETERS
+ * filepath     The path to the file
+ *
+ * NOTE
+ * The returned array should be freed with `free` after usage.
+ *
+ * RETURN
+ * frequencies  An array of size 127 with the frequency of each ascii
+ *              charater or NULL in case of error.
+ * ------------------------------------------------------------------------- */
+double* fqFromCsv(const char* filepath);
+
+#endif // _FREQUENCIES_H_
@@ -0,0 +1,112 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "MappedFile.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+struct mapped_file_t {
+    unsigned char* data;
+    size_t size;
+};
+
+#ifdef MAPPED_FILE_MMAP
+
+MappedFile* mfOpen(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat status;
+    MappedFile* file = malloc(sizeof(MappedFile));
+    if (!file || fstat(fd, &status) < 0) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+
+    file->data = NULL;
+    file->size = (size_t) status.st_size;
+    if (file->size > 0) { // Empty files cannot be mapped
+        void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            free(file);
+            close(fd);
+            return NULL;
+        }
+        posix_madvise(data, file->size, POSIX_MADV_SEQUENTIAL);
+        file->data = data;
+    }
+
+    // The mapping stays valid once the descriptor is closed
+    close(fd);
+    return file;
+}
+
+void mfClose(MappedFile* file) {
+    if (!file) {
+        return;
+    }
+    if (file->data) {
+        munmap(file->data, file->size);
+    }
+    free(file);
+}
+
+#else
+
+MappedFile* mfOpen(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    MappedFile* file = malloc(sizeof(MappedFile));
+    if (!file || fseek(fp, 0, SEEK_END) != 0) {
+        free(file);
+        fclose(fp);
+        return NULL;
+    }
+    long size = ftell(fp);
+    rewind(fp);
+
+    file->size = size > 0 ? (size_t) size : 0;
+    file->data = file->size > 0 ? malloc(file->size) : NULL;
+    if ((file->size > 0 && !file->data) ||
+        fread(file->data, 1, file->size, fp) != file->size) {
+        free(file->data);
+        free(file);
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+    return file;
+}
+
+void mfClose(MappedFile* file) {
+    if (!file) {
+        return;
+    }
+    free(file->data);
+    free(file);
+}
+
+#endif
+
+const unsigned char* mfData(const MappedFile* file) {
+    return file->data;
+}
+
+size_t mfSize(const MappedFile* file) {
+    return file->size;
+}
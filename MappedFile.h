@@ -0,0 +1,65 @@
+/* ========================================================================= *
+ * Read-only file mapped in memory.
+ *
+ * NOTE
+ * - On POSIX systems the file is mapped with `mmap` and the kernel is told
+ *   that it will be read sequentially. Elsewhere, it is read in a buffer.
+ * ========================================================================= */
+
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <stddef.h>
+
+/* Opaque structure */
+typedef struct mapped_file_t MappedFile;
+
+/* ------------------------------------------------------------------------- *
+ * Map a whole file in memory, read-only.
+ *
+ * PARAMETERS
+ * path         The path to the file
+ *
+ * NOTE
+ * The returned structure should be cleaned with `mfClose` after usage.
+ *
+ * RETURN
+ * file         The mapped file, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+MappedFile* mfOpen(const char* path);
+
+
+/* ------------------------------------------------------------------------- *
+ * Unmap the file and free the memory allocated for the structure.
+ *
+ * PARAMETERS
+ * file         The mapped file
+ * ------------------------------------------------------------------------- */
+void mfClose(MappedFile* file);
+
+
+/* ------------------------------------------------------------------------- *
+ * Return the content of the file.
+ *
+ * PARAMETERS
+ * file         A valid pointer to the mapped file
+ *
+ * RETURN
+ * data         The bytes of the file, valid until `mfClose` (NULL if the
+ *              file is empty)
+ * ------------------------------------------------------------------------- */
+const unsigned char* mfData(const MappedFile* file);
+
+
+/* ------------------------------------------------------------------------- *
+ * Return the size of the file.
+ *
+ * PARAMETERS
+ * file         A valid pointer to the mapped file
+ *
+ * RETURN
+ * size         The number of bytes of the file
+ * ------------------------------------------------------------------------- */
+size_t mfSize(const MappedFile* file);
+
+#endif // _MAPPED_FILE_H_
@@ -0,0 +1,232 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "TableCache.h"
+#include "MappedFile.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TABLE_CACHE_PID
+#include <unistd.h>
+#endif
+
+static const size_t ASCII_SIZE = 127;
+static const unsigned char MAGIC[4] = {'H', 'U', 'F', 'C'};
+static const uint32_t VERSION = 1;
+static const uint32_t BYTE_ORDER = 0x01020304;
+static const size_t PATH_SIZE = 4096;
+
+// Start of a cache file, followed by the 127 packed codes, then by the
+// entries of the decoding table.
+typedef struct cache_header_t {
+    unsigned char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t entry_size;
+    uint64_t key;
+    uint64_t n_entries;
+    uint64_t primary_bits;
+    uint64_t max_length;
+    uint64_t reserved[2];
+} CacheHeader;
+
+struct table_cache_t {
+    MappedFile* file;
+    // Points to the mapped entries.
+    DecodingTable* table;
+};
+
+static size_t codes_offset(void) {
+    return sizeof(CacheHeader);
+}
+
+static size_t entries_offset(void) {
+    return sizeof(CacheHeader) + ASCII_SIZE * sizeof(PackedCode);
+}
+
+static uint64_t fnv1a(uint64_t hash, const unsigned char* bytes,
+                      size_t n_bytes) {
+    for (size_t i = 0; i < n_bytes; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Computes the key of a code: a hash of the CSV contents and of everything
+ * else the tables depend on.
+ * @param csvPath The path to the frequency CSV file
+ * @param maxLength The maximum code length, 0 for the Huffman code
+ * @param key Where to write the key
+ * @return true on success, false if the CSV cannot be read
+ */
+static bool cache_key(const char* csvPath, size_t maxLength, uint64_t* key) {
+    MappedFile* csv = mfOpen(csvPath);
+    if (!csv) {
+        return false;
+    }
+
+    uint64_t hash = fnv1a(0xCBF29CE484222325ULL, mfData(csv), mfSize(csv));
+    uint64_t parameters[4] = {maxLength, DT_PRIMARY_BITS, DT_SECONDARY_BITS,
+                              VERSION};
+    *key = fnv1a(hash, (const unsigned char*) parameters, sizeof(parameters));
+
+    mfClose(csv);
+    return true;
+}
+
+static bool cache_path(const char* directory, uint64_t key, char* path) {
+    int length = snprintf(path, PATH_SIZE, "%s/huffman-%016llx.tbl",
+                          directory, (unsigned long long) key);
+    return length > 0 && (size_t) length < PATH_SIZE;
+}
+
+/**
+ * Checks that a mapped cache file holds the tables of the given key, and
+ * that the links of its decoding table stay within the table.
+ * @param data The mapped file
+ * @param size The size of the file
+ * @param key The expected key
+ * @param header Where to copy the header of the file
+ * @return true if the file is valid, false otherwise
+ */
+static bool cache_valid(const unsigned char* data, size_t size, uint64_t key,
+                        CacheHeader* header) {
+    if (size < entries_offset()) {
+        return false;
+    }
+    memcpy(header, data, sizeof(CacheHeader));
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION || header->byte_order != BYTE_ORDER ||
+        header->entry_size != sizeof(DtEntry) || header->key != key ||
+        header->n_entries > UINT16_MAX ||
+        size != entries_offset() + header->n_entries * sizeof(DtEntry) ||
+        header->primary_bits == 0 ||
+        header->primary_bits > header->max_length ||
+        header->max_length > DT_MAX_CODE_LENGTH ||
+        (((uint64_t) 1) << header->primary_bits) > header->n_entries) {
+        return false;
+    }
+
+    const DtEntry* entries = (const DtEntry*) (data + entries_offset());
+    for (size_t i = 0; i < header->n_entries; i++) {
+        const DtEntry* entry = &entries[i];
+        if (entry->sub_bits > DT_SECONDARY_BITS ||
+            entry->length > header->max_length ||
+            (entry->sub_bits && entry->value + (((size_t) 1) <<
+                                entry->sub_bits) > header->n_entries)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TableCache* tcLoad(const char* directory, const char* csvPath,
+                   size_t maxLength) {
+    uint64_t key;
+    char path[PATH_SIZE];
+    if (!cache_key(csvPath, maxLength, &key) ||
+        !cache_path(directory, key, path)) {
+        return NULL;
+    }
+
+    MappedFile* file = mfOpen(path);
+    if (!file) {
+        return NULL;
+    }
+
+    CacheHeader header;
+    TableCache* cache = malloc(sizeof(TableCache));
+    if (!cache || !cache_valid(mfData(file), mfSize(file), key, &header)) {
+        free(cache);
+        mfClose(file);
+        return NULL;
+    }
+
+    // The mapping is read-only, entries are never written through the table.
+    // Only the multi-symbol table is built, in a few microseconds.
+    cache->file = file;
+    cache->table = dtFromEntries((const DtEntry*) (mfData(file) +
+                                                   entries_offset()),
+                                 (size_t) header.n_entries,
+                                 (size_t) header.primary_bits,
+                                 (size_t) header.max_length);
+    if (!cache->table) {
+        tcClose(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+bool tcStore(const char* directory, const char* csvPath, size_t maxLength,
+             const PackedCode* codes, const DecodingTable* table) {
+    uint64_t key;
+    char path[PATH_SIZE];
+    char temporary[PATH_SIZE];
+    if (!cache_key(csvPath, maxLength, &key) ||
+        !cache_path(directory, key, path)) {
+        return false;
+    }
+
+#ifdef TABLE_CACHE_PID
+    long id = (long) getpid();
+#else
+    long id = 0;
+#endif
+    int length = snprintf(temporary, PATH_SIZE, "%s.%ld.tmp", path, id);
+    if (length <= 0 || (size_t) length >= PATH_SIZE) {
+        return false;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER;
+    header.entry_size = sizeof(DtEntry);
+    header.key = key;
+    size_t n_entries, primary_bits;
+    const DtEntry* entries = dtEntries(table, &n_entries, &primary_bits);
+    header.n_entries = n_entries;
+    header.primary_bits = primary_bits;
+    header.max_length = dtMaxCodeLength(table);
+
+    FILE* fp = fopen(temporary, "wb");
+    if (!fp) {
+        return false;
+    }
+    bool success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                   fwrite(codes, sizeof(PackedCode), ASCII_SIZE, fp) ==
+                   ASCII_SIZE &&
+                   fwrite(entries, sizeof(DtEntry), n_entries, fp) ==
+                   n_entries;
+    success = fclose(fp) == 0 && success;
+
+    // Readers either see the previous file or the complete new one
+    success = success && rename(temporary, path) == 0;
+    if (!success) {
+        remove(temporary);
+    }
+    return success;
+}
+
+const PackedCode* tcCodes(const TableCache* cache) {
+    return (const PackedCode*) (mfData(cache->file) + codes_offset());
+}
+
+const DecodingTable* tcTable(const TableCache* cache) {
+    return cache->table;
+}
+
+void tcClose(TableCache* cache) {
+    if (!cache) {
+        return;
+    }
+    mfClose(cache->file);
+    dtFree(cache->table);
+    free(cache);
+}
@@ -0,0 +1,82 @@
+/* ========================================================================= *
+ * Table cache interface.
+ *
+ * NOTE
+ * - The coding and decoding tables built from a frequency CSV are stored in
+ *   a cache directory, in a file named after a hash of the CSV contents and
+ *   of the parameters of the code. Later runs map that file and use the
+ *   tables in place, without parsing the CSV nor building anything.
+ * - Cache files are mapped read-only, so concurrent processes share their
+ *   pages. They are written to a temporary file first and renamed, so that
+ *   a process never maps a partially written file.
+ * - The files are in the native byte order of the machine, and are rejected
+ *   if anything does not match: they are not meant to be exchanged.
+ * ========================================================================= */
+
+#ifndef _TABLE_CACHE_H_
+#define _TABLE_CACHE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "CodingTree.h"
+#include "DecodingTable.h"
+
+/* Opaque structure */
+typedef struct table_cache_t TableCache;
+
+/* ------------------------------------------------------------------------- *
+ * Map the cached tables of the code built from a frequency CSV.
+ *
+ * PARAMETERS
+ * directory    The cache directory
+ * csvPath      The path to the frequency CSV file
+ * maxLength    The maximum code length the code was built with, 0 for the
+ *              Huffman code
+ *
+ * NOTE
+ * The returned structure should be cleaned with `tcClose` after usage.
+ *
+ * RETURN
+ * cache        The cached tables, or NULL if they are not in the cache or
+ *              the cache file is not valid
+ * ------------------------------------------------------------------------- */
+TableCache* tcLoad(const char* directory, const char* csvPath,
+                   size_t maxLength);
+
+/* ------------------------------------------------------------------------- *
+ * Store the tables of the code built from a frequency CSV in the cache.
+ *
+ * PARAMETERS
+ * directory    The cache directory, which must exist
+ * csvPath      The path to the frequency CSV file
+ * maxLength    The maximum code length the code was built with, 0 for the
+ *              Huffman code
+ * codes        The packed code of each ascii character
+ * table        The decoding table of the code
+ *
+ * RETURN
+ * success      True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool tcStore(const char* directory, const char* csvPath, size_t maxLength,
+             const PackedCode* codes, const DecodingTable* table);
+
+/* ------------------------------------------------------------------------- *
+ * Return the packed codes of the cached code, an array of size 127.
+ * ------------------------------------------------------------------------- */
+const PackedCode* tcCodes(const TableCache* cache);
+
+/* ------------------------------------------------------------------------- *
+ * Return the decoding table of the cached code.
+ * ------------------------------------------------------------------------- */
+const DecodingTable* tcTable(const TableCache* cache);
+
+/* ------------------------------------------------------------------------- *
+ * Unmap the cached tables.
+ *
+ * PARAMETERS
+ * cache        The cached tables
+ * ------------------------------------------------------------------------- */
+void tcClose(TableCache* cache);
+
+#endif // _TABLE_CACHE_H_
@@ -0,0 +1,404 @@
+/* ========================================================================= *
+ * Throughput benchmark.
+ *
+ * SYNOPSIS
+ * huffman_bench [-n bytes] [-r repetitions] csvPath [textPath...]
+ *
+ * DESCRIPTION
+ * Encode and decode each given text and three generated ones of `bytes`
+ * characters (64 MiB by default): a text drawn from the CSV frequencies, a
+ * low entropy text made of the 4 most frequent characters and a high
+ * entropy text uniform over the printable characters. Each case is run
+ * `repetitions` times (3 by default) and the best run is reported, in MB of
+ * text per second and in cycles per byte (x86 only), along with the ratio
+ * between the encoded and the plain sizes and the peak resident memory.
+ * Each corpus is run in its own child process, so that the peak resident
+ * memory is that of the corpus and not the peak of all the previous ones.
+ *
+ * The priority queue is chosen at link time: `huffman_bench` uses the heap
+ * and `huffman_bench_list` the linked list, the time to build the coding
+ * tree comparing them.
+ * ========================================================================= */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BENCH_RUSAGE
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_RDTSC
+#include <x86intrin.h>
+#endif
+
+#include "CodingTree.h"
+#include "CharVector.h"
+#include "coding.h"
+#include "MappedFile.h"
+#include "Frequencies.h"
+
+#ifndef BENCH_PQ_NAME
+#define BENCH_PQ_NAME "unknown"
+#endif
+
+static const size_t ASCII_SIZE = 127;
+static const size_t DEFAULT_BYTES = 1 << 26;
+static const size_t DEFAULT_REPETITIONS = 3;
+static const size_t TREE_BUILDS = 1000;
+static const size_t LIMITED_LENGTH = DT_PRIMARY_BITS;
+
+typedef struct measure_t {
+    double seconds;
+    uint64_t cycles;
+} Measure;
+
+typedef struct corpus_t {
+    const char* name;
+    CharVector* text;
+} Corpus;
+
+static uint64_t nextRandom(uint64_t* state) {
+    // xorshift64*, so that the generated texts are the same on every run
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Generates a text of `n_chars` characters drawn independently from the
+ * given weights.
+ * @param weights An array of size 127 with the weight of each character
+ * @param n_chars The number of characters to generate
+ * @return the text, or NULL on error
+ */
+static CharVector* generateText(const double* weights, size_t n_chars) {
+    double cumulative[ASCII_SIZE];
+    double total = 0;
+    for (size_t c = 0; c < ASCII_SIZE; c++) {
+        total += weights[c];
+        cumulative[c] = total;
+    }
+
+    CharVector* text = cvCreate(n_chars + 1);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; text && i < n_chars; i++) {
+        double x = (nextRandom(&state) >> 11) * (1.0 / 9007199254740992.0)
+                   * total;
+        size_t low = 0, high = ASCII_SIZE - 1;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (cumulative[middle] <= x) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (!cvAdd(text, (char) low)) {
+            cvFree(text);
+            return NULL;
+        }
+    }
+    return text;
+}
+
+static CharVector* readText(const char* path) {
+    MappedFile* file = mfOpen(path);
+    if (!file) {
+        return NULL;
+    }
+    const unsigned char* data = mfData(file);
+    CharVector* text = cvCreate(mfSize(file) + 1);
+    for (size_t i = 0; text && i < mfSize(file); i++) {
+        // Same filter as the encoder
+        if (data[i] < ASCII_SIZE && !cvAdd(text, (char) data[i])) {
+            cvFree(text);
+            text = NULL;
+        }
+    }
+    mfClose(file);
+    return text;
+}
+
+static Measure now(void) {
+    Measure measure;
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    measure.seconds = time.tv_sec + time.tv_nsec * 1e-9;
+#ifdef BENCH_RDTSC
+    measure.cycles = __rdtsc();
+#else
+    measure.cycles = 0;
+#endif
+    return measure;
+}
+
+static Measure elapsed(Measure start) {
+    Measure end = now();
+    end.seconds -= start.seconds;
+    end.cycles -= start.cycles;
+    return end;
+}
+
+static size_t peakMemory(void) {
+#ifdef BENCH_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return (size_t) usage.ru_maxrss / 1024;
+#else
+        return (size_t) usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static void report(const char* corpus, const char* name, size_t n_bytes,
+                   Measure best, double ratio) {
+    printf("%-14s %-22s %10.1f", corpus, name,
+           n_bytes / best.seconds / 1e6);
+    if (best.cycles) {
+        printf(" %10.2f", (double) best.cycles / n_bytes);
+    } else {
+        printf(" %10s", "-");
+    }
+    printf(" %8.4f\n", ratio);
+}
+
+/**
+ * Encodes the corpus with `tree`, then decodes it with the table and by
+ * walking the tree, reporting each case.
+ * @param corpus The text to encode
+ * @param tree The coding tree
+ * @param name The name of the code
+ * @param repetitions The number of runs of each case
+ * @return true on success, false on error or if a decoded text differs
+ */
+static bool benchCode(const Corpus* corpus, const CodingTree* tree,
+                      const char* name, size_t repetitions) {
+    size_t n_bytes = cvSize(corpus->text);
+    char label[64];
+    Measure best[3];
+    BinarySequence* encoded = NULL;
+    bool success = true;
+
+    for (size_t r = 0; success && r < repetitions; r++) {
+        biseFree(encoded);
+        encoded = biseCreate();
+        Measure start = now();
+        success = encoded && encode(corpus->text, encoded, tree);
+        Measure measure = elapsed(start);
+        if (r == 0 || measure.seconds < best[0].seconds) {
+            best[0] = measure;
+        }
+    }
+
+    for (size_t d = 1; success && d < 3; d++) {
+        for (size_t r = 0; success && r < repetitions; r++) {
+            CharVector* decoded = cvCreate(n_bytes + 1);
+            Measure start = now();
+            success = decoded &&
+                      (d == 1 ? decode(encoded, decoded, tree)
+                              : decode2(encoded, decoded, tree));
+            Measure measure = elapsed(start);
+            if (r == 0 || measure.seconds < best[d].seconds) {
+                best[d] = measure;
+            }
+
+            success = success && cvSize(decoded) == n_bytes;
+            for (size_t i = 0; success && i < n_bytes; i++) {
+                success = cvGet(decoded, i) == cvGet(corpus->text, i);
+            }
+            if (decoded) {
+                cvFree(decoded);
+            }
+        }
+    }
+
+    if (success) {
+        double ratio = (double) biseGetNumberOfBytes(encoded) / n_bytes;
+        snprintf(label, sizeof(label), "encode %s", name);
+        report(corpus->name, label, n_bytes, best[0], ratio);
+        snprintf(label, sizeof(label), "decode table %s", name);
+        report(corpus->name, label, n_bytes, best[1], ratio);
+        snprintf(label, sizeof(label), "decode tree %s", name);
+        report(corpus->name, label, n_bytes, best[2], ratio);
+    }
+
+    biseFree(encoded);
+    return success;
+}
+
+/**
+ * Benchmarks a corpus with the Huffman code and the length-limited code.
+ * @param corpus The text to encode
+ * @param frequencies The frequencies of the characters
+ * @param repetitions The number of runs of each case
+ * @return true on success, false on error
+ */
+static bool benchCorpus(const Corpus* corpus, const double* frequencies,
+                        size_t repetitions) {
+    if (cvSize(corpus->text) == 0) {
+        return true;
+    }
+
+    CodingTree* huffman = ctHuffman(frequencies);
+    CodingTree* limited = ctHuffmanLimited(frequencies, LIMITED_LENGTH);
+    char name[32];
+    snprintf(name, sizeof(name), "L<=%zu", LIMITED_LENGTH);
+
+    bool success = huffman && limited &&
+                   benchCode(corpus, huffman, "huffman", repetitions) &&
+                   benchCode(corpus, limited, name, repetitions);
+    if (success) {
+        printf("%-14s peak RSS %zu KiB\n", corpus->name, peakMemory());
+    } else {
+        fprintf(stderr, "Benchmark failed on corpus '%s'.\n", corpus->name);
+    }
+
+    if (huffman)
+        ctFree(huffman);
+    if (limited)
+        ctFree(limited);
+    return success;
+}
+
+/**
+ * Runs `benchCorpus` in a forked child process, whose peak resident memory
+ * only covers this corpus (and the pages shared with the parent, the corpus
+ * text included). Runs it in this process if it cannot fork.
+ * @param corpus The text to encode
+ * @param frequencies The frequencies of the characters
+ * @param repetitions The number of runs of each case
+ * @return true on success, false on error
+ */
+static bool benchIsolated(const Corpus* corpus, const double* frequencies,
+                          size_t repetitions) {
+#ifdef BENCH_RUSAGE
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        bool success = benchCorpus(corpus, frequencies, repetitions);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (pid > 0) {
+        int status;
+        return waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+               WEXITSTATUS(status) == EXIT_SUCCESS;
+    }
+#endif
+    return benchCorpus(corpus, frequencies, repetitions);
+}
+
+static void benchTreeBuild(const double* frequencies) {
+    Measure start = now();
+    for (size_t i = 0; i < TREE_BUILDS; i++) {
+        CodingTree* tree = ctHuffman(frequencies);
+        if (tree)
+            ctFree(tree);
+    }
+    Measure measure = elapsed(start);
+    printf("tree build (%s priority queue): %.2f us\n", BENCH_PQ_NAME,
+           measure.seconds / TREE_BUILDS * 1e6);
+
+    unsigned char lengths[ASCII_SIZE];
+    start = now();
+    for (size_t i = 0; i < TREE_BUILDS; i++) {
+        ctHuffmanCodeLengths(frequencies, true, lengths);
+    }
+    measure = elapsed(start);
+    printf("code lengths (two queues): %.2f us\n",
+           measure.seconds / TREE_BUILDS * 1e6);
+}
+
+int main(int argc, char** argv) {
+    size_t n_bytes = DEFAULT_BYTES;
+    size_t repetitions = DEFAULT_REPETITIONS;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n_bytes = (size_t) strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repetitions = (size_t) strtoull(argv[++i], NULL, 10);
+        } else {
+            break;
+        }
+    }
+    if (i >= argc || repetitions == 0) {
+        fprintf(stderr, "USAGE: %s [-n <bytes>] [-r <repetitions>] "
+                        "<csvPath> [<textPath>...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double* frequencies = fqFromCsv(argv[i]);
+    if (!frequencies) {
+        fprintf(stderr, "Could not read CSV '%s'.\n", argv[i]);
+        return EXIT_FAILURE;
+    }
+
+    benchTreeBuild(frequencies);
+    printf("%-14s %-22s %10s %10s %8s\n", "corpus", "case", "MB/s",
+           "cycles/B", "ratio");
+
+    bool success = true;
+    for (i++; success && i < argc; i++) {
+        Corpus corpus = {argv[i], readText(argv[i])};
+        if (!corpus.text) {
+            fprintf(stderr, "Could not read text '%s'.\n", argv[i]);
+            success = false;
+            break;
+        }
+        success = benchIsolated(&corpus, frequencies, repetitions);
+        cvFree(corpus.text);
+    }
+
+    // Low entropy: the 4 most frequent characters, equally likely
+    double low[ASCII_SIZE];
+    memset(low, 0, sizeof(low));
+    for (size_t k = 0; k < 4; k++) {
+        size_t top = ASCII_SIZE;
+        for (size_t c = 0; c < ASCII_SIZE; c++) {
+            if (!low[c] &&
+                (top == ASCII_SIZE || frequencies[c] > frequencies[top])) {
+                top = c;
+            }
+        }
+        low[top] = 1;
+    }
+    // High entropy: all printable characters, equally likely
+    double high[ASCII_SIZE];
+    memset(high, 0, sizeof(high));
+    for (size_t c = ' '; c < ASCII_SIZE; c++) {
+        high[c] = 1;
+    }
+
+    const char* names[] = {"csv-model", "low-entropy", "high-entropy"};
+    const double* weights[] = {frequencies, low, high};
+    for (size_t g = 0; success && g < 3; g++) {
+        Corpus corpus = {names[g], generateText(weights[g], n_bytes)};
+        if (!corpus.text) {
+            fprintf(stderr, "Could not generate text '%s'.\n", names[g]);
+            success = false;
+            break;
+        }
+        success = benchIsolated(&corpus, frequencies, repetitions);
+        cvFree(corpus.text);
+    }
+
+    free(frequencies);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
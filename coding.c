@@ -1,21 +1,161 @@
 #include "coding.h"
 
-bool encode(const CharVector* source, BinarySequence* dest, const CodingTree* tree, unsigned char eof) {
-    BinarySequence** table = ctCodingTable(tree);
-    if(!table)
+#include <string.h>
+
+static const unsigned char MAGIC[4] = {'H', 'U', 'F', 'T'};
+static const unsigned char VERSION = 1;
+
+static void put_uint(unsigned char* bytes, uint64_t value, size_t n_bytes) {
+    for (size_t i = 0; i < n_bytes; i++)
+        bytes[i] = (unsigned char) (value >> (8 * i));
+}
+
+static uint64_t get_uint(const unsigned char* bytes, size_t n_bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < n_bytes; i++)
+        value |= ((uint64_t) bytes[i]) << (8 * i);
+    return value;
+}
+
+void writeTextHeader(const TextHeader* header, unsigned char* bytes) {
+    memcpy(bytes, MAGIC, sizeof(MAGIC));
+    bytes[4] = VERSION;
+    bytes[5] = header->flags;
+    put_uint(bytes + 6, header->n_chars, 8);
+    put_uint(bytes + 14, header->n_bits, 8);
+}
+
+bool readTextHeader(const unsigned char* bytes, size_t n_bytes,
+                    TextHeader* header) {
+    if (n_bytes < TEXT_HEADER_SIZE || memcmp(bytes, MAGIC, sizeof(MAGIC)) ||
+        bytes[4] != VERSION || (bytes[5] != 0 && bytes[5] != TEXT_CANONICAL &&
+        bytes[5] != TEXT_ADAPTIVE && bytes[5] != TEXT_CONTEXT))
+        return false;
+
+    uint64_t n_chars = get_uint(bytes + 6, 8);
+    uint64_t n_bits = get_uint(bytes + 14, 8);
+    if (!(bytes[5] & TEXT_CONTEXT) && n_chars == UINT64_MAX &&
+        n_bits == UINT64_MAX) {
+        header->flags = bytes[5];
+        header->n_chars = header->n_bits = TEXT_UNKNOWN_SIZE;
+        return true;
+    }
+    // Every code has at least one bit
+    if (n_chars > n_bits || n_bits > SIZE_MAX - 8 * TEXT_HEADER_SIZE)
+        return false;
+
+    header->flags = bytes[5];
+    header->n_chars = (size_t) n_chars;
+    header->n_bits = (size_t) n_bits;
+    return true;
+}
+
+void writeTextTrailer(const TextHeader* header, unsigned char* bytes) {
+    put_uint(bytes, header->n_chars, 8);
+    put_uint(bytes + 8, header->n_bits, 8);
+}
+
+bool readTextTrailer(const unsigned char* bytes, TextHeader* header) {
+    uint64_t n_chars = get_uint(bytes, 8);
+    uint64_t n_bits = get_uint(bytes + 8, 8);
+    // Every code has at least one bit
+    if (n_chars > n_bits || n_bits > SIZE_MAX - 8 * TEXT_HEADER_SIZE)
         return false;
 
+    header->n_chars = (size_t) n_chars;
+    header->n_bits = (size_t) n_bits;
+    return true;
+}
+
+void encodedSize(const size_t* counts, const PackedCode* table,
+                 TextHeader* header) {
+    header->n_chars = 0;
+    header->n_bits = 0;
+    for (size_t c = 0; c < 127; c++) {
+        header->n_chars += counts[c];
+        header->n_bits += counts[c] * ctCodeLength(table[c]);
+    }
+}
+
+// Counts the ascii characters of a vector, as `countCharacters`.
+static void count_vector(const CharVector* source, size_t* counts) {
+    memset(counts, 0, 127 * sizeof(size_t));
+    char c;
+    for (size_t i = 0; i < cvSize(source); i++) {
+        c = cvGet(source, i);
+        if(c >= 0 && c < 127)
+            counts[(size_t)c]++;
+    }
+}
+
+static bool write_header(BitWriter* writer, const TextHeader* header) {
+    unsigned char bytes[TEXT_HEADER_SIZE];
+    writeTextHeader(header, bytes);
+
     bool success = true;
+    for (size_t i = 0; i < TEXT_HEADER_SIZE; i++)
+        success &= biseWriteBits(writer, bytes[i], 8);
+    return success;
+}
+
+// Writes the header, the code lengths if any, then the encoded characters.
+static bool encode_packed(const CharVector* source, BinarySequence* dest,
+                          const PackedCode* table,
+                          const unsigned char* lengths) {
+    size_t counts[127];
+    count_vector(source, counts);
+    TextHeader header = {lengths ? TEXT_CANONICAL : 0, 0, 0};
+    encodedSize(counts, table, &header);
+
+    BitWriter writer;
+    biseWriterInit(&writer, dest);
+    bool success = write_header(&writer, &header);
+    if (lengths)
+        success = success && ctWriteCodeLengths(&writer, lengths);
+
     char c;
     for (size_t i = 0; i < cvSize(source); i++) {
         c = cvGet(source, i);
         if(c < 0 || c >= 127) // Filtering out non-ascii
             continue;
-        success &= biseAddSequence(dest, table[(size_t)c]);
+        PackedCode code = table[(size_t)c];
+        success &= biseWriteBits(&writer, ctCodeBits(code), ctCodeLength(code));
     }
+    success &= biseWriterFlush(&writer);
 
-    // add end of file code
-    success &= biseAddSequence(dest, table[eof]);
+    return success;
+}
+
+bool encode(const CharVector* source, BinarySequence* dest, const CodingTree* tree) {
+    PackedCode packed[127];
+    if (ctPackedCodingTable(tree, packed))
+        return encodeWithTable(source, dest, packed);
+
+    // Some codes are too long to be packed, append them as sequences
+    BinarySequence** table = ctCodingTable(tree);
+    if(!table)
+        return false;
+
+    size_t counts[127];
+    count_vector(source, counts);
+    TextHeader header = {0, 0, 0};
+    for (size_t c = 0; c < 127; c++) {
+        header.n_chars += counts[c];
+        header.n_bits += counts[c] * biseGetNumberOfBits(table[c]);
+    }
+
+    BitWriter writer;
+    biseWriterInit(&writer, dest);
+
+    bool success = write_header(&writer, &header);
+    char c;
+    for (size_t i = 0; i < cvSize(source); i++) {
+        c = cvGet(source, i);
+        if(c < 0 || c >= 127) // Filtering out non-ascii
+            continue;
+        success &= biseWriteSequence(&writer, table[(size_t)c]);
+    }
+    success &= biseWriterFlush(&writer);
 
     for(size_t i = 0; i < 127; i++)
         biseFree(table[i]);
@@ -23,3 +163,60 @@ bool encode(const CharVector* source, BinarySequence* dest, const CodingTree* tr
 
     return success;
 }
+
+bool encodeCanonical(const CharVector* source, BinarySequence* dest,
+                     const CodingTree* tree) {
+    unsigned char lengths[127];
+    PackedCode table[127];
+    if (!ctCodeLengths(tree, lengths) || !ctCanonicalCodingTable(lengths, table))
+        return false;
+
+    return encode_packed(source, dest, table, lengths);
+}
+
+void countCharacters(const char* chars, size_t n_chars, size_t* counts) {
+    // Consecutive characters are counted in different tables, so that runs
+    // of the same character do not wait on the previous increment.
+    uint32_t tables[4][256];
+    const unsigned char* bytes = (const unsigned char*) chars;
+    while (n_chars > 0) {
+        // Bounded so that the 32-bit counters cannot overflow
+        size_t n = n_chars < ((size_t) 1 << 30) ? n_chars : ((size_t) 1 << 30);
+        memset(tables, 0, sizeof(tables));
+
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            tables[0][bytes[i]]++;
+            tables[1][bytes[i + 1]]++;
+            tables[2][bytes[i + 2]]++;
+            tables[3][bytes[i + 3]]++;
+        }
+        for (; i < n; i++)
+            tables[0][bytes[i]]++;
+
+        for (size_t c = 0; c < 127; c++)
+            counts[c] += (size_t) tables[0][c] + tables[1][c] + tables[2][c] +
+                         tables[3][c];
+        bytes += n;
+        n_chars -= n;
+    }
+}
+
+bool encodeChunk(const char* chars, size_t n_chars, BitWriter* writer,
+                 const PackedCode* table) {
+    bool success = true;
+    char c;
+    for (size_t i = 0; i < n_chars; i++) {
+        c = chars[i];
+        if(c < 0 || c >= 127) // Filtering out non-ascii
+            continue;
+        PackedCode code = table[(size_t)c];
+        success &= biseWriteBits(writer, ctCodeBits(code), ctCodeLength(code));
+    }
+    return success;
+}
+
+bool encodeWithTable(const CharVector* source, BinarySequence* dest,
+                     const PackedCode* table) {
+    return encode_packed(source, dest, table, NULL);
+}
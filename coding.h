@@ -6,44 +6,288 @@
 #define _CODING_H_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 
 #include "BinarySequence.h"
 #include "CodingTree.h"
 #include "CharVector.h"
+#include "DecodingTable.h"
+
+/* ------------------------------------------------------------------------- *
+ * Header of an encoded text, in front of everything the encoders write (but
+ * the blocks, see BlockCoding.h). The decoders know the size of the text
+ * before decoding it, and detect truncated or corrupted inputs.
+ *
+ * FORMAT
+ * All integers are stored in little endian.
+ * - Magic "HUFT" (4 bytes), version (1 byte), flags (1 byte, see below)
+ * - Number of characters of the text (8 bytes)
+ * - Number of bits of the encoded characters (8 bytes), the code lengths
+ *   and the padding excluded
+ * The header is followed by the code lengths if TEXT_CANONICAL is set, then
+ * by the encoded characters, padded to a whole byte.
+ *
+ * When the encoder could not go back to the header to write the sizes (its
+ * output is a pipe), both are TEXT_UNKNOWN_SIZE and are written instead in
+ * a trailer of TEXT_TRAILER_SIZE bytes after the padded characters:
+ * - Number of characters of the text (8 bytes)
+ * - Number of bits of the encoded characters (8 bytes)
+ * A text with TEXT_CONTEXT set always has its sizes in its header.
+ *
+ * FLAGS
+ * - TEXT_CANONICAL: the text is encoded with a canonical code whose code
+ *   lengths, as written by `ctWriteCodeLengths`, follow the header.
+ * - TEXT_ADAPTIVE: the text is encoded with an adaptive code (see
+ *   AdaptiveTree.h), which ends with its own end of text: unknown sizes
+ *   are not followed by a trailer.
+ * - TEXT_CONTEXT: each character is encoded with the code of the character
+ *   before it, the codes of all contexts following the header (see
+ *   ContextCoding.h).
+ * At most one flag is set.
+ * ------------------------------------------------------------------------- */
+#define TEXT_HEADER_SIZE 22
+#define TEXT_CANONICAL 0x01
+#define TEXT_ADAPTIVE 0x02
+#define TEXT_CONTEXT 0x04
+#define TEXT_UNKNOWN_SIZE SIZE_MAX
+#define TEXT_TRAILER_SIZE 16
+
+typedef struct text_header_t {
+    unsigned char flags;
+    size_t n_chars;
+    size_t n_bits;
+} TextHeader;
+
+/* ------------------------------------------------------------------------- *
+ * Write a header in its binary format.
+ *
+ * PARAMETERS
+ * header     The header to write.
+ * bytes      An array of size TEXT_HEADER_SIZE where to write the header.
+ * ------------------------------------------------------------------------- */
+void writeTextHeader(const TextHeader* header, unsigned char* bytes);
+
+/* ------------------------------------------------------------------------- *
+ * Read a header written by `writeTextHeader`.
+ *
+ * PARAMETERS
+ * bytes      The start of the encoded file.
+ * n_bytes    The number of bytes available.
+ * header     The header to fill.
+ *
+ * RETURN
+ * success    True on success, false if the bytes do not start with a valid
+ *            header
+ * ------------------------------------------------------------------------- */
+bool readTextHeader(const unsigned char* bytes, size_t n_bytes,
+                    TextHeader* header);
+
+/* ------------------------------------------------------------------------- *
+ * Write the sizes of a header in the binary format of a trailer.
+ *
+ * PARAMETERS
+ * header     The header whose sizes to write.
+ * bytes      An array of size TEXT_TRAILER_SIZE where to write the trailer.
+ * ------------------------------------------------------------------------- */
+void writeTextTrailer(const TextHeader* header, unsigned char* bytes);
+
+/* ------------------------------------------------------------------------- *
+ * Read the sizes of a header whose sizes are unknown from its trailer.
+ *
+ * PARAMETERS
+ * bytes      The last TEXT_TRAILER_SIZE bytes of the encoded file.
+ * header     The header whose `n_chars` and `n_bits` are set.
+ *
+ * RETURN
+ * success    True on success, false if the sizes are not valid
+ * ------------------------------------------------------------------------- */
+bool readTextTrailer(const unsigned char* bytes, TextHeader* header);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the number of characters and of bits of a text from the number of
+ * occurrences of its characters.
+ *
+ * PARAMETERS
+ * counts     An array of size 127 with the occurrences of each character
+ *            (see `countCharacters`).
+ * table      The code of each ascii character.
+ * header     The header whose `n_chars` and `n_bits` are set.
+ * ------------------------------------------------------------------------- */
+void encodedSize(const size_t* counts, const PackedCode* table,
+                 TextHeader* header);
 
 /* ------------------------------------------------------------------------- *
  * Encode an ascii encoded text using the given coding tree.
  *
  * PARAMETERS
  * source     A vector containing the characters to encode.
- * dest       A binary sequence where to write the encoded text.
+ * dest       A binary sequence where to write the header and the encoded
+ *            text.
  * tree       The coding tree to use for encoding. All characters found in 
  *  		  source should be contained in this tree.
- * eof        The eof file character to add at the end of the sequence to 
- *			  indicate the end of the encoded content. 
  *
  * RETURN
  * success    True on success, false on error
  * ------------------------------------------------------------------------- */
-bool encode(const CharVector* source, BinarySequence* dest, const CodingTree* tree, unsigned char eof);
+bool encode(const CharVector* source, BinarySequence* dest, const CodingTree* tree);
+
+/* ------------------------------------------------------------------------- *
+ * Encode an ascii encoded text using the given packed coding table.
+ *
+ * PARAMETERS
+ * source     A vector containing the characters to encode.
+ * dest       A binary sequence where to write the header and the encoded
+ *            text.
+ * table      An array of size 127 mapping each ascii character to its code
+ *            (see `ctPackedCodingTable`).
+ *
+ * RETURN
+ * success    True on success, false on error
+ * ------------------------------------------------------------------------- */
+bool encodeWithTable(const CharVector* source, BinarySequence* dest,
+                     const PackedCode* table);
+
+/* ------------------------------------------------------------------------- *
+ * Count the occurrences of each ascii character in a text, adding them to
+ * the given counts. Non-ascii characters are ignored.
+ *
+ * PARAMETERS
+ * chars      The characters to count.
+ * n_chars    The number of characters.
+ * counts     An array of size 127 to which the occurrences are added.
+ * ------------------------------------------------------------------------- */
+void countCharacters(const char* chars, size_t n_chars, size_t* counts);
 
 /* ------------------------------------------------------------------------- *
  * Decode an encoded text using the given coding tree. 
  *
  * PARAMETERS
- * source     The binary sequence to decode.
- * dest       A vector where to write the decoded characters.
+ * source     The binary sequence to decode, starting with its header.
+ * dest       A vector where to write the decoded characters. It grows
+ *            once, by the number of characters given by the header.
  * tree       The coding tree to use for encoding. All codes found in 
  *            source should have a corresponding decoding path in this tree.
- * eof        The character indicating the end of the encoded content. When
- *            reached, the decode function should ignore the remaining bits
- *            in source.
+ *
+ * RETURN
+ * success    True on success, false on error or if source is truncated
+ * ------------------------------------------------------------------------- */
+bool decode(const BinarySequence* source, CharVector* dest, const CodingTree* tree);
+
+/* ------------------------------------------------------------------------- *
+ * Decode an encoded text by walking the coding tree bit by bit. Same as
+ * `decode`, which falls back to it when no decoding table can be built.
+ *
+ * PARAMETERS
+ * source     The binary sequence to decode, starting with its header.
+ * dest       A vector where to write the decoded characters.
+ * tree       The coding tree to use for decoding.
+ *
+ * RETURN
+ * success    True on success, false on error or if source is truncated
+ * ------------------------------------------------------------------------- */
+bool decode2(const BinarySequence* source, CharVector* dest,
+             const CodingTree* tree);
+
+/* ------------------------------------------------------------------------- *
+ * Decode an encoded text using the given decoding table.
+ *
+ * PARAMETERS
+ * reader     A bit reader positioned at the start of the encoded characters,
+ *            after the header and the code lengths.
+ * dest       A vector where to write the decoded characters.
+ * table      The decoding table to use.
+ * header     The header of the text.
+ *
+ * RETURN
+ * success    True on success, false on error, if the reader holds less bits
+ *            than the header gives or if the codes do not end there
+ * ------------------------------------------------------------------------- */
+bool decodeWithTable(BitReader* reader, CharVector* dest,
+                     const DecodingTable* table, const TextHeader* header);
+
+/* ------------------------------------------------------------------------- *
+ * Encode a chunk of an ascii encoded text, continuing the bits already
+ * appended by the writer. No header is written.
+ *
+ * PARAMETERS
+ * chars      The characters to encode.
+ * n_chars    The number of characters to encode.
+ * writer     The bit writer where to append the encoded characters.
+ * table      An array of size 127 mapping each ascii character to its code.
  *
  * RETURN
  * success    True on success, false on error
  * ------------------------------------------------------------------------- */
-bool decode(const BinarySequence* source, CharVector* dest, const CodingTree* tree, unsigned char eof);
+bool encodeChunk(const char* chars, size_t n_chars, BitWriter* writer,
+                 const PackedCode* table);
+
+/* ------------------------------------------------------------------------- *
+ * Decode the characters whose code starts before the bit `limit`, stopping
+ * early when `capacity` characters were decoded.
+ *
+ * PARAMETERS
+ * reader     A bit reader positioned at the start of a code.
+ * limit      The index of the bit from which no code is decoded.
+ * table      The decoding table to use.
+ * dest       An array where to write the decoded characters.
+ * capacity   The size of dest.
+ * n_decoded  Set to the number of decoded characters.
+ *
+ * RETURN
+ * success    True on success, false if the bits do not match any code or if
+ *            a code goes beyond the end of the input.
+ * ------------------------------------------------------------------------- */
+bool decodeChunk(BitReader* reader, size_t limit, const DecodingTable* table,
+                 char* dest, size_t capacity, size_t* n_decoded);
+
+/* ------------------------------------------------------------------------- *
+ * Decode exactly `n_chars` characters, without checking for the end of the
+ * input before each of them.
+ *
+ * PARAMETERS
+ * reader     A bit reader positioned at the start of a code.
+ * table      The decoding table to use.
+ * dest       An array of size n_chars where to write the decoded characters.
+ * n_chars    The number of characters to decode.
+ *
+ * RETURN
+ * success    True on success, false if the bits do not match any code or if
+ *            a code goes beyond the end of the input.
+ * ------------------------------------------------------------------------- */
+bool decodeCounted(BitReader* reader, const DecodingTable* table, char* dest,
+                   size_t n_chars);
+
+/* ------------------------------------------------------------------------- *
+ * Encode an ascii encoded text with the canonical code having the same code
+ * lengths as the given coding tree. The code lengths are written after the
+ * header so that the text can be decoded without the tree.
+ *
+ * PARAMETERS
+ * source     A vector containing the characters to encode.
+ * dest       A binary sequence where to write the header, the code lengths
+ *            and the encoded text.
+ * tree       The coding tree to use for encoding.
+ *
+ * RETURN
+ * success    True on success, false on error (including codes longer than
+ *            CT_MAX_PACKED_LENGTH bits)
+ * ------------------------------------------------------------------------- */
+bool encodeCanonical(const CharVector* source, BinarySequence* dest,
+                     const CodingTree* tree);
+
+/* ------------------------------------------------------------------------- *
+ * Decode a text encoded by `encodeCanonical`, rebuilding the code from the
+ * code lengths found after the header.
+ *
+ * PARAMETERS
+ * source     The binary sequence to decode.
+ * dest       A vector where to write the decoded characters.
+ *
+ * RETURN
+ * success    True on success, false on error or if source is truncated
+ * ------------------------------------------------------------------------- */
+bool decodeCanonical(const BinarySequence* source, CharVector* dest);
 
 #endif // _CODING_H_
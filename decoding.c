@@ -1,4 +1,5 @@
 #include "coding.h"
+#include "DecodingTable.h"
 
 
 static void bise_print(BinarySequence* bs) {
@@ -8,56 +9,125 @@ static void bise_print(BinarySequence* bs) {
     printf("\n");
 }
 
+// Reads the header at the start of a sequence, and its sizes from the
+// trailer at the end of the sequence when the header does not have them.
+static bool read_header(const BinarySequence* source, TextHeader* header) {
+    unsigned char bytes[TEXT_HEADER_SIZE];
+    size_t n_bytes = (biseGetNumberOfBits(source) + 7) / 8;
+    if (n_bytes < TEXT_HEADER_SIZE)
+        return false;
+    for (size_t i = 0; i < TEXT_HEADER_SIZE; i++)
+        bytes[i] = biseGetByte(source, i, ZERO);
+    if (!readTextHeader(bytes, TEXT_HEADER_SIZE, header))
+        return false;
+    if (header->n_chars != TEXT_UNKNOWN_SIZE)
+        return true;
+    if (header->flags & TEXT_ADAPTIVE ||
+        n_bytes < TEXT_HEADER_SIZE + TEXT_TRAILER_SIZE)
+        return false;
+
+    unsigned char trailer[TEXT_TRAILER_SIZE];
+    for (size_t i = 0; i < TEXT_TRAILER_SIZE; i++)
+        trailer[i] = biseGetByte(source, n_bytes - TEXT_TRAILER_SIZE + i,
+                                 ZERO);
+    return readTextTrailer(trailer, header);
+}
+
 bool decode(const BinarySequence* source, CharVector* dest,
-            const CodingTree* tree, unsigned char eof) {
+            const CodingTree* tree) {
     if (dest == NULL || tree == NULL)
-        return NULL;
+        return false;
 
-    // Iterate over the sequence bytes, stop if we reach the last byte.
-    size_t current_bit = 0;
-    while (current_bit < biseGetNumberOfBits(source) - 8) {
-        BinarySequence* bs = biseCreate();
-        for(size_t i = 0; i < 8; i++) {
-            Binary bin = biseGetBit(source, current_bit + i);
-            biseAddBit(bs, bin);
-        }
-        unsigned char c = biseGetByte(bs, 0, ZERO);
+    TextHeader header;
+    if (!read_header(source, &header) || header.flags != 0)
+        return false;
 
-        if (c == eof)
-            break;
-        cvAdd(dest, (char) c);
+    // Codes too long for a decoding table, walk the tree instead.
+    PackedCode codes[127];
+    DecodingTable* table = NULL;
+    if (ctPackedCodingTable(tree, codes))
+        table = dtCreate(codes);
+    if (!table)
+        return decode2(source, dest, tree);
 
-        biseFree(bs);
+    BitReader reader;
+    biseReaderInit(&reader, source, 8 * TEXT_HEADER_SIZE);
+    bool success = decodeWithTable(&reader, dest, table, &header);
 
-        current_bit += 8;
-    }
+    dtFree(table);
+    return success;
+}
+
+bool decodeWithTable(BitReader* reader, CharVector* dest,
+                     const DecodingTable* table, const TextHeader* header) {
+    // The whole text is there, no code can go beyond the end of the input
+    size_t start = biseReaderTell(reader);
+    if (start > reader->n_bits || reader->n_bits - start < header->n_bits)
+        return false;
 
-    return true;
+    char* chars = cvExtend(dest, header->n_chars);
+    return chars && decodeCounted(reader, table, chars, header->n_chars) &&
+           biseReaderTell(reader) == start + header->n_bits;
 }
 
-bool decode2(const BinarySequence* source, CharVector* dest,
-            const CodingTree* tree, unsigned char eof) {
-    if (dest == NULL || tree == NULL)
-        return NULL;
+bool decodeChunk(BitReader* reader, size_t limit, const DecodingTable* table,
+                 char* dest, size_t capacity, size_t* n_decoded) {
+    return dtDecodeChunk(table, reader, limit, dest, capacity, n_decoded);
+}
 
-    // Iterate over the sequence bytes, stop if we reach the last byte.
-    size_t current_bit = 0;
-    while (current_bit < biseGetNumberOfBits(source) - 7) {
-        Decoded d = ctDecode(tree, source, current_bit);
+bool decodeCounted(BitReader* reader, const DecodingTable* table, char* dest,
+                   size_t n_chars) {
+    return dtDecodeCounted(table, reader, dest, n_chars);
+}
 
-        // Check if we reached the end of the sequence.
-        if (d.character == eof)
-            break;
+bool decodeCanonical(const BinarySequence* source, CharVector* dest) {
+    if (dest == NULL)
+        return false;
 
-        printf("%c", d.character);
+    TextHeader header;
+    if (!read_header(source, &header) || header.flags != TEXT_CANONICAL)
+        return false;
 
-        // Try to add the character to the char vector.
-        bool success = cvAdd(dest, d.character);
-        if (!success)
-            return false;
+    BitReader reader;
+    biseReaderInit(&reader, source, 8 * TEXT_HEADER_SIZE);
 
-        current_bit = d.nextBit;
-    }
+    unsigned char lengths[127];
+    PackedCode codes[127];
+    if (!ctReadCodeLengths(&reader, lengths) ||
+        !ctCanonicalCodingTable(lengths, codes))
+        return false;
 
-    return true;
-}
\ No newline at end of file
+    DecodingTable* table = dtCreate(codes);
+    if (!table)
+        return false;
+
+    // The encoded text directly follows the code lengths.
+    bool success = decodeWithTable(&reader, dest, table, &header);
+
+    dtFree(table);
+    return success;
+}
+
+bool decode2(const BinarySequence* source, CharVector* dest,
+            const CodingTree* tree) {
+    if (dest == NULL || tree == NULL)
+        return false;
+
+    TextHeader header;
+    size_t start = 8 * TEXT_HEADER_SIZE;
+    if (!read_header(source, &header) || header.flags != 0 ||
+        biseGetNumberOfBits(source) - start < header.n_bits)
+        return false;
+
+    char* chars = cvExtend(dest, header.n_chars);
+    if (!chars)
+        return false;
+
+    // The bits were checked to be there, only the end is checked.
+    BitReader reader;
+    biseReaderInit(&reader, source, start);
+    for (size_t i = 0; i < header.n_chars; i++)
+        chars[i] = ctDecodeNext(tree, &reader).character;
+
+    return biseReaderTell(&reader) == start + header.n_bits;
+}
@@ -0,0 +1,147 @@
+/* ========================================================================= *
+ * Built-in tables generator.
+ *
+ * SYNOPSIS
+ * gentables [-o outputPath] name=csvPath...
+ *
+ * DESCRIPTION
+ * Build the code of each frequency CSV file with `ctHuffman` and write a
+ * header defining its constant coding and decoding tables under the given
+ * name, along with the BUILTIN_CODES array used by BuiltinCodes.c.
+ *
+ * NOTE
+ * The generator must be linked with the same priority queue as `huffman`
+ * for the built-in codes to be those built from the CSV at runtime.
+ * ========================================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "CodingTree.h"
+#include "DecodingTable.h"
+#include "Frequencies.h"
+
+static const size_t ASCII_SIZE = 127;
+
+static bool isIdentifier(const char* name, size_t length) {
+    if (length == 0 || isdigit((unsigned char) name[0]))
+        return false;
+    for (size_t i = 0; i < length; i++)
+        if (!isalnum((unsigned char) name[i]) && name[i] != '_')
+            return false;
+    return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write the coding and decoding tables of the code built from a CSV.
+ *
+ * PARAMETERS
+ * name         The name of the code, a valid C identifier
+ * csvPath      The path to the frequency CSV file
+ * output       The file where to write the tables
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool writeCode(const char* name, const char* csvPath, FILE* output) {
+    double* frequencies = fqFromCsv(csvPath);
+    if (!frequencies) {
+        fprintf(stderr, "Could not parse CSV '%s'.\n", csvPath);
+        return false;
+    }
+
+    CodingTree* tree = ctHuffman(frequencies);
+    PackedCode codes[ASCII_SIZE];
+    DecodingTable* table = NULL;
+    if (tree && ctPackedCodingTable(tree, codes))
+        table = dtCreate(codes);
+
+    bool success = table != NULL;
+    if (success) {
+        fprintf(output, "/* %s */\n", csvPath);
+        fprintf(output, "static const PackedCode %s_codes[%zu] = {", name,
+                ASCII_SIZE);
+        for (size_t c = 0; c < ASCII_SIZE; c++)
+            fprintf(output, "%s0x%llxULL,", c % 4 ? " " : "\n    ",
+                    (unsigned long long) codes[c]);
+        fprintf(output, "\n};\n\n");
+        success = dtWriteSource(table, name, output);
+    } else {
+        fprintf(stderr, "Could not build the code of '%s'.\n", csvPath);
+    }
+
+    dtFree(table);
+    if (tree)
+        ctFree(tree);
+    free(frequencies);
+    return success;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = NULL;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        outputPath = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "USAGE: %s [-o <outputPath>] <name>=<csvPath>...\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (int i = first; i < argc; i++) {
+        const char* separator = strchr(argv[i], '=');
+        if (!separator || !isIdentifier(argv[i], separator - argv[i])) {
+            fprintf(stderr, "Invalid code '%s', expected <name>=<csvPath> "
+                            "with a C identifier as name.\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    FILE* output = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!output) {
+        fprintf(stderr, "Could not open file '%s'.\n", outputPath);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(output, "/* Generated by gentables, do not edit. */\n\n"
+                    "#ifndef _BUILTIN_TABLES_H_\n"
+                    "#define _BUILTIN_TABLES_H_\n\n"
+                    "#include \"BuiltinCodes.h\"\n\n");
+
+    bool success = true;
+    char name[256];
+    for (int i = first; success && i < argc; i++) {
+        size_t length = strchr(argv[i], '=') - argv[i];
+        if (length >= sizeof(name)) {
+            fprintf(stderr, "Name too long in '%s'.\n", argv[i]);
+            success = false;
+            break;
+        }
+        memcpy(name, argv[i], length);
+        name[length] = '\0';
+        success = writeCode(name, argv[i] + length + 1, output);
+    }
+
+    fprintf(output, "static const BuiltinCode BUILTIN_CODES[] = {\n");
+    for (int i = first; i < argc; i++) {
+        int length = (int) (strchr(argv[i], '=') - argv[i]);
+        fprintf(output, "    {\"%.*s\", %.*s_codes, &%.*s_table},\n",
+                length, argv[i], length, argv[i], length, argv[i]);
+    }
+    fprintf(output, "};\n\n"
+                    "static const size_t N_BUILTIN_CODES = %d;\n\n"
+                    "#endif // _BUILTIN_TABLES_H_\n", argc - first);
+
+    success = success && !ferror(output);
+    if (output != stdout) {
+        success = fclose(output) == 0 && success;
+        if (!success) // Do not leave a partial header behind
+            remove(outputPath);
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,25 +3,32 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
-#include <time.h>
+#include <errno.h>
 
 #include "CodingTree.h"
 #include "CharVector.h"
 #include "coding.h"
+#include "MappedFile.h"
+#include "BlockCoding.h"
+#include "Frequencies.h"
+#include "BuiltinCodes.h"
+#include "TableCache.h"
+#include "AdaptiveTree.h"
+#include "ContextCoding.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
 
 static const size_t ASCII_SIZE = 127;
 static const size_t BUFFER_SIZE = 1024;
 static const size_t CHAR_VECTOR_INIT_CAP = 100;
+static const size_t STREAM_CHUNK_SIZE = 1 << 16;
+static const size_t BLOCK_SIZE = 1 << 20;
 
 /* ------------------------------------------------------------------------- *
- * Parse a ascii frequency csv file.
- *
- * CSV STRUCTURE
- * Each line is a pair ascii code (in integer format)-frequency, separated
- * by a comma. There is no additionnal space before and/or after the code,
- * the comma or the frequency. The frequency is expressed as a double between
- * 0 and 1.
- * Only one blank line at the end of the file is allowed.
+ * Compute the frequency of each ascii character in the file `path`, in a
+ * first pass over the mapped file.
  *
  * PARAMETERS
  * filepath     The path to the file
@@ -30,40 +37,31 @@ static const size_t CHAR_VECTOR_INIT_CAP = 100;
  * frequencies  An array of size 127 with the frequency of each ascii
  *              charater or NULL in case of error.
  * ------------------------------------------------------------------------- */
-static double* csvToFrequencies(const char* filepath) {
-    char buffer[BUFFER_SIZE];
-
-    FILE* fp = fopen(filepath, "r");
+static double* inputToFrequencies(const char* filepath) {
+    MappedFile* file = mfOpen(filepath);
+    if (!file)
+        return NULL;
 
+    size_t counts[ASCII_SIZE];
     double* frequencies = (double*) calloc(ASCII_SIZE, sizeof(double));
     if (!frequencies) {
-        fclose(fp);
+        mfClose(file);
         return NULL;
     }
 
-    char character;
-    char* nextPart;
+    memset(counts, 0, sizeof(counts));
+    countCharacters((const char*) mfData(file), mfSize(file), counts);
 
-    // Read line by line
-    while (fgets(buffer, BUFFER_SIZE, fp)) {
-        // Parse char and frequency
-        character = (char) strtol(buffer, &nextPart, 10);
-        if (buffer == nextPart) // Could not parse char ascii code
-        {
-            free(frequencies);
-            fclose(fp);
-            return NULL;
-        }
-
-        while (!isdigit(*nextPart) &&
-               (*nextPart) != '.') // Skip space and comma
-            nextPart++;
-
-        frequencies[(size_t) character] = strtod(nextPart, NULL);;
-    }
+    size_t total = 0;
+    for (size_t c = 0; c < ASCII_SIZE; c++)
+        total += counts[c];
+    for (size_t c = 0; c < ASCII_SIZE && total > 0; c++)
+        frequencies[c] = (double) counts[c] / (double) total;
+    // An empty text still needs a code to be written
+    if (total == 0)
+        frequencies[0] = 1.0;
 
-
-    fclose(fp);
+    mfClose(file);
     return frequencies;
 }
 
@@ -149,12 +147,38 @@ static CharVector* readAsciiText(const char* path) {
 
 
 /* ------------------------------------------------------------------------- *
- * Read the given binary input file, decode it thanks to `tree` and save
- * the result in `outputPath`.
+ * Print which options an encoded file needs to be decoded, when the ones
+ * given cannot decode it.
  *
  * PARAMETERS
  * inputPath    The path to the binary input file
- * tree         The coding tree to decode the file
+ * flags        The flags of the header of the file (see coding.h)
+ * ------------------------------------------------------------------------- */
+static void printMissingOption(const char* inputPath, unsigned char flags) {
+    if (flags == 0)
+        fprintf(stderr, "'%s' was encoded with the code of a CSV, which is "
+                        "needed to decode it.\n", inputPath);
+    else if (flags == TEXT_CANONICAL)
+        fprintf(stderr, "'%s' was encoded with -c or -a, decode it "
+                        "without -p.\n", inputPath);
+    else if (flags == TEXT_ADAPTIVE)
+        fprintf(stderr, "'%s' was encoded with -p, decode it with -p.\n",
+                inputPath);
+    else
+        fprintf(stderr, "'%s' was encoded with -1, which is not streamed: "
+                        "decode it without -p, -s, -m, -t or -k.\n",
+                inputPath);
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Read the given binary input file, decode it with the code given by the
+ * flags of its header and save the result in `outputPath`.
+ *
+ * PARAMETERS
+ * inputPath    The path to the binary input file
+ * tree         The coding tree to decode the file if its code is not in the
+ *              file, or NULL
  * outputPath   The path to the output file, or NULL to print on standard
  *              output
  *
@@ -162,7 +186,7 @@ static CharVector* readAsciiText(const char* path) {
  * success      true in case of succes, false otherwise
  * ------------------------------------------------------------------------- */
 static bool readAndDecode(const char* inputpath, const CodingTree* tree,
-                          const char* outptPath, unsigned char eof) {
+                          const char* outptPath) {
     FILE* output = (!outptPath) ? stdout : fopen(outptPath, "wb");
 
     bool success = true;
@@ -181,15 +205,27 @@ static bool readAndDecode(const char* inputpath, const CodingTree* tree,
         success = false;
     }
 
-    printf("HUFFMAN:\n");
-    clock_t start = clock();
-    success = success && decode(source, dest, tree, eof);
-    clock_t end = clock();
-    float seconds = (float) (end - start) / CLOCKS_PER_SEC;
-    printf("%lf\n", seconds);
-    printf("\n\n\n");
+    // The code to decode with is given by the flags of the header
+    unsigned char headerBytes[TEXT_HEADER_SIZE];
+    TextHeader header = {0, 0, 0};
+    bool known = biseGetNumberOfBits(source) >= 8 * TEXT_HEADER_SIZE;
+    for (size_t i = 0; known && i < TEXT_HEADER_SIZE; i++)
+        headerBytes[i] = biseGetByte(source, i, ZERO);
+    known = known && readTextHeader(headerBytes, TEXT_HEADER_SIZE, &header);
+    bool reported = known && (header.flags == TEXT_ADAPTIVE ||
+                              (header.flags == 0 && !tree));
+    if (reported) {
+        printMissingOption(inputpath, header.flags);
+        success = false;
+    } else if (header.flags == TEXT_CONTEXT) {
+        success = success && decodeContext(source, dest);
+    } else if (header.flags == TEXT_CANONICAL) {
+        success = success && decodeCanonical(source, dest);
+    } else {
+        success = success && tree && decode(source, dest, tree);
+    }
 
-    if (!success)
+    if (!success && !reported)
         fprintf(stderr, "Could not decode binary sequence from file '%s'.\n",
                 inputpath);
     else
@@ -213,13 +249,17 @@ static bool readAndDecode(const char* inputpath, const CodingTree* tree,
  * tree         The coding tree to encode the file
  * outputPath   The path to the output file, or NULL to print on standard
  *              output
+ * canonical    Whether to use the canonical code and write its code lengths
+ *              in front of the encoded text
+ * context      Whether to use the codes of the order-1 contexts of the text
+ *              instead of `tree`, and write them in front of the encoded text
  *
  * RETURN
  * success      true in case of succes, false otherwise
  * ------------------------------------------------------------------------- */
 static bool readAndEncode(const char* inputpath, const CodingTree* tree,
                           const char* outptPath, bool debug,
-                          unsigned char eof) {
+                          bool canonical, bool context) {
     FILE* output = (!outptPath) ? stdout : fopen(outptPath, "wb");
 
     bool success = true;
@@ -239,7 +279,12 @@ static bool readAndEncode(const char* inputpath, const CodingTree* tree,
         success = false;
     }
 
-    success = success && encode(source, dest, tree, eof);
+    if (context)
+        success = success && encodeContext(source, dest);
+    else if (canonical)
+        success = success && encodeCanonical(source, dest, tree);
+    else
+        success = success && encode(source, dest, tree);
 
     if (!success)
         fprintf(stderr, "Could not encode text from file '%s'.\n",
@@ -279,12 +324,740 @@ static bool readAndEncode(const char* inputpath, const CodingTree* tree,
 }
 
 
+/* ------------------------------------------------------------------------- *
+ * Open the input of a stream, "-" standing for the standard input.
+ *
+ * PARAMETERS
+ * path         The path to the input file, or "-"
+ *
+ * RETURN
+ * file         The opened file, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+static FILE* openStreamInput(const char* path) {
+    return strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Encode the given ascii input chunk by chunk, writing the encoded bytes of
+ * each chunk as soon as it is encoded. Only a chunk and the bits of its
+ * codes are held in memory.
+ *
+ * The sizes of the header are written over it once the text is encoded when
+ * the output is a file, and in a trailer after the encoded text otherwise
+ * (see coding.h), so that both the input and the output can be pipes.
+ *
+ * PARAMETERS
+ * inputPath    The path to the ascii input file, or "-" for standard input
+ * tree         The coding tree to encode the file, unused with prebuilt codes
+ * prebuilt     The packed codes to encode the file with, built in or cached,
+ *              or NULL to use the tree
+ * outputPath   The path to the output file, or NULL to print on standard
+ *              output
+ * canonical    Whether to use the canonical code and write its code lengths
+ *              after the header
+ * mapped       Whether to map the input file in memory and encode its pages
+ *              directly rather than reading it in a buffer
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool streamEncode(const char* inputPath, const CodingTree* tree,
+                         const PackedCode* prebuilt, const char* outputPath,
+                         bool canonical, bool mapped) {
+    unsigned char lengths[ASCII_SIZE];
+    PackedCode codes[ASCII_SIZE];
+    const PackedCode* table = prebuilt ? prebuilt : codes;
+    bool success = prebuilt ||
+                   (canonical ?
+                    ctCodeLengths(tree, lengths) &&
+                    ctCanonicalCodingTable(lengths, codes) :
+                    ctPackedCodingTable(tree, codes));
+    if (!success) {
+        fprintf(stderr, "Codes are too long to be streamed.\n");
+        return false;
+    }
+
+    FILE* input = NULL;
+    MappedFile* file = NULL;
+    if (mapped)
+        file = mfOpen(inputPath);
+    else
+        input = openStreamInput(inputPath);
+    if (!input && !file) {
+        fprintf(stderr, "Could not open file '%s'.\n", inputPath);
+        return false;
+    }
+    FILE* output = (!outputPath) ? stdout : fopen(outputPath, "wb");
+
+    char* chunk = mapped ? NULL : malloc(STREAM_CHUNK_SIZE);
+    BinarySequence* dest = biseCreate();
+    if ((!mapped && !chunk) || !dest || !output) {
+        fprintf(stderr, "Could not allocate the stream buffers.\n");
+        success = false;
+    }
+
+    // The sizes are unknown until the end of the text, and written in a
+    // trailer if the output cannot be rewound to the header
+    long headerOffset = success ? ftell(output) : -1;
+    TextHeader header = {canonical ? TEXT_CANONICAL : 0,
+                         headerOffset < 0 ? TEXT_UNKNOWN_SIZE : 0,
+                         headerOffset < 0 ? TEXT_UNKNOWN_SIZE : 0};
+    unsigned char headerBytes[TEXT_HEADER_SIZE];
+    size_t counts[ASCII_SIZE];
+    memset(counts, 0, sizeof(counts));
+
+    BitWriter writer;
+    if (success) {
+        writeTextHeader(&header, headerBytes);
+        success = fwrite(headerBytes, 1, TEXT_HEADER_SIZE, output) ==
+                  TEXT_HEADER_SIZE;
+        biseWriterInit(&writer, dest);
+        if (canonical)
+            success = success && ctWriteCodeLengths(&writer, lengths);
+    }
+
+    if (mapped) {
+        const char* data = (const char*) mfData(file);
+        size_t size = mfSize(file);
+        for (size_t offset = 0; success && offset < size;
+             offset += STREAM_CHUNK_SIZE) {
+            size_t chunk_size = size - offset < STREAM_CHUNK_SIZE ?
+                                size - offset : STREAM_CHUNK_SIZE;
+            countCharacters(data + offset, chunk_size, counts);
+            success = encodeChunk(data + offset, chunk_size, &writer, table)
+                      && biseWriterEmit(&writer, output);
+        }
+    }
+
+    size_t read_size;
+    while (success && !mapped &&
+           (read_size = fread(chunk, sizeof(char), STREAM_CHUNK_SIZE,
+                              input)) > 0) {
+        countCharacters(chunk, read_size, counts);
+        success = encodeChunk(chunk, read_size, &writer, table) &&
+                  biseWriterEmit(&writer, output);
+    }
+
+    if (success) {
+        // Padding up to a whole byte
+        success = biseWriteBits(&writer, 0, (8 - writer.n_buffered % 8) % 8)
+                  && biseWriterEmit(&writer, output);
+    }
+    if (success && headerOffset < 0) {
+        unsigned char trailer[TEXT_TRAILER_SIZE];
+        encodedSize(counts, table, &header);
+        writeTextTrailer(&header, trailer);
+        success = fwrite(trailer, 1, TEXT_TRAILER_SIZE, output) ==
+                  TEXT_TRAILER_SIZE;
+    } else if (success) {
+        encodedSize(counts, table, &header);
+        writeTextHeader(&header, headerBytes);
+        success = fseek(output, headerOffset, SEEK_SET) == 0 &&
+                  fwrite(headerBytes, 1, TEXT_HEADER_SIZE, output) ==
+                  TEXT_HEADER_SIZE;
+    }
+    if (!success || (input && ferror(input)))
+        fprintf(stderr, "Could not encode text from file '%s'.\n",
+                inputPath);
+
+    free(chunk);
+    biseFree(dest);
+    mfClose(file);
+    if (input && input != stdin)
+        fclose(input);
+    if (output && output != stdout)
+        fclose(output);
+    return success;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Decode the given binary input chunk by chunk, writing the decoded
+ * characters of each chunk as soon as they are decoded. Only a chunk of the
+ * input and of the output are held in memory.
+ *
+ * PARAMETERS
+ * inputPath    The path to the binary input file, or "-" for standard input
+ * tree         The coding tree to decode the file if its code is not in the
+ *              file and there is no prebuilt table, or NULL
+ * prebuilt     The decoding table to decode the file with, built in or
+ *              cached, or NULL to use the tree
+ * outputPath   The path to the output file, or NULL to print on standard
+ *              output
+ * mapped       Whether to map the input file in memory and decode its pages
+ *              directly rather than reading it in a buffer
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool streamDecode(const char* inputPath, const CodingTree* tree,
+                         const DecodingTable* prebuilt, const char* outputPath,
+                         bool mapped) {
+    FILE* input = NULL;
+    MappedFile* file = NULL;
+    if (mapped)
+        file = mfOpen(inputPath);
+    else
+        input = openStreamInput(inputPath);
+    if (!input && !file) {
+        fprintf(stderr, "Could not open file '%s'.\n", inputPath);
+        return false;
+    }
+    FILE* output = (!outputPath) ? stdout : fopen(outputPath, "wb");
+
+    // A mapped file is decoded in place, as a single chunk
+    unsigned char* buffer = mapped ? NULL : malloc(STREAM_CHUNK_SIZE);
+    const unsigned char* bytes = mapped ? mfData(file) : buffer;
+    char* decoded = malloc(STREAM_CHUNK_SIZE);
+    bool success = (mapped || buffer) && decoded && output;
+
+    const DecodingTable* table = NULL;
+    DecodingTable* built = NULL;
+    PackedCode codes[ASCII_SIZE];
+    bool reported = false;
+
+    // Bits dropped from the buffer so far, and bits where the codes start
+    // and end. Unknown sizes are read from the trailer at the end of input.
+    size_t n_bytes = mapped ? mfSize(file) : 0, position = 0, dropped = 0;
+    size_t start = 0, end = 0, remaining = 0, written = 0;
+    bool endOfInput = mapped, readHeader = false, trailer = false;
+    while (success && (!readHeader || remaining > 0)) {
+        // Keep the unread bytes and fill the rest of the buffer
+        if (!endOfInput) {
+            size_t first = position / 8;
+            memmove(buffer, buffer + first, n_bytes - first);
+            n_bytes -= first;
+            position -= 8 * first;
+            dropped += 8 * first;
+            size_t read_size = fread(buffer + n_bytes, sizeof(unsigned char),
+                                     STREAM_CHUNK_SIZE - n_bytes, input);
+            n_bytes += read_size;
+            endOfInput = n_bytes < STREAM_CHUNK_SIZE;
+        }
+
+        BitReader reader;
+        biseReaderInitBuffer(&reader, bytes, 8 * n_bytes, position);
+
+        if (!readHeader) { // The whole header fits in the first chunk
+            // The code to decode with is given by the flags of the header
+            TextHeader header;
+            success = readTextHeader(bytes, n_bytes, &header);
+            reported = success && (header.flags & ~TEXT_CANONICAL ||
+                                   (header.flags == 0 && !prebuilt &&
+                                    !tree));
+            if (reported) {
+                printMissingOption(inputPath, header.flags);
+                success = false;
+            }
+            biseReaderInitBuffer(&reader, bytes, 8 * n_bytes,
+                                 8 * TEXT_HEADER_SIZE);
+            if (success && header.flags == TEXT_CANONICAL) {
+                unsigned char lengths[ASCII_SIZE];
+                success = ctReadCodeLengths(&reader, lengths) &&
+                          ctCanonicalCodingTable(lengths, codes) &&
+                          (table = built = dtCreate(codes)) != NULL;
+            } else if (success && prebuilt) {
+                table = prebuilt;
+            } else if (success) {
+                built = ctPackedCodingTable(tree, codes) ?
+                        dtCreate(codes) : NULL;
+                table = built;
+                success = table != NULL;
+            }
+            if (!success)
+                break;
+            readHeader = true;
+            trailer = header.n_chars == TEXT_UNKNOWN_SIZE;
+            remaining = header.n_chars;
+            start = biseReaderTell(&reader);
+            end = trailer ? TEXT_UNKNOWN_SIZE : start + header.n_bits;
+        }
+
+        if (endOfInput && trailer) {
+            // The codes must end, padded, right before the trailer
+            TextHeader sizes;
+            success = n_bytes >= TEXT_TRAILER_SIZE &&
+                      readTextTrailer(bytes + n_bytes - TEXT_TRAILER_SIZE,
+                                      &sizes) &&
+                      sizes.n_chars >= written &&
+                      (start + sizes.n_bits + 7) / 8 ==
+                      dropped / 8 + n_bytes - TEXT_TRAILER_SIZE;
+            if (!success)
+                break;
+            trailer = false;
+            remaining = sizes.n_chars - written;
+            end = start + sizes.n_bits;
+        }
+
+        if (endOfInput) {
+            // All the codes are in the buffer, unless it is truncated
+            success = dropped + 8 * n_bytes >= end;
+            while (success && remaining > 0) {
+                size_t n = remaining < STREAM_CHUNK_SIZE ?
+                           remaining : STREAM_CHUNK_SIZE;
+                success = decodeCounted(&reader, table, decoded, n) &&
+                          fwrite(decoded, sizeof(char), n, output) == n;
+                remaining -= n;
+            }
+        } else {
+            // Only decode the codes which are entirely in the buffer, and
+            // not in what could be the trailer
+            size_t margin = dtMaxCodeLength(table) +
+                            (trailer ? 8 * TEXT_TRAILER_SIZE : 0);
+            size_t limit = 8 * n_bytes > margin ? 8 * n_bytes - margin : 0;
+            size_t n_decoded = 0, capacity = 0;
+            while (success && remaining > 0 && n_decoded == capacity) {
+                capacity = remaining < STREAM_CHUNK_SIZE ?
+                           remaining : STREAM_CHUNK_SIZE;
+                success = decodeChunk(&reader, limit, table, decoded,
+                                      capacity, &n_decoded) &&
+                          fwrite(decoded, sizeof(char), n_decoded, output)
+                          == n_decoded;
+                remaining -= n_decoded;
+                written += n_decoded;
+            }
+        }
+        position = biseReaderTell(&reader);
+    }
+
+    // The codes must end exactly where the header says
+    success = success && dropped + position == end;
+    if ((!success && !reported) || (input && ferror(input)))
+        fprintf(stderr, "Could not decode binary sequence from file '%s'.\n",
+                inputPath);
+
+    dtFree(built);
+    free(buffer);
+    free(decoded);
+    mfClose(file);
+    if (input && input != stdin)
+        fclose(input);
+    if (output && output != stdout)
+        fclose(output);
+    return success;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Encode the given ascii input in a single pass with an adaptive code (see
+ * AdaptiveTree.h), chunk by chunk, writing the encoded bytes of each chunk
+ * as soon as it is encoded. No CSV nor first pass is needed, so that the
+ * input can be a pipe.
+ *
+ * The sizes of the header are written over it once the text is encoded when
+ * the output is a file, and left unknown otherwise.
+ *
+ * PARAMETERS
+ * inputPath    The path to the ascii input file, or "-" for standard input
+ * outputPath   The path to the output file, or NULL to print on standard
+ *              output
+ * mapped       Whether to map the input file in memory and encode its pages
+ *              directly rather than reading it in a buffer
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool onePassEncode(const char* inputPath, const char* outputPath,
+                          bool mapped) {
+    FILE* input = NULL;
+    MappedFile* file = NULL;
+    if (mapped)
+        file = mfOpen(inputPath);
+    else
+        input = openStreamInput(inputPath);
+    if (!input && !file) {
+        fprintf(stderr, "Could not open file '%s'.\n", inputPath);
+        return false;
+    }
+    FILE* output = (!outputPath) ? stdout : fopen(outputPath, "wb");
+
+    char* chunk = mapped ? NULL : malloc(STREAM_CHUNK_SIZE);
+    BinarySequence* dest = biseCreate();
+    AdaptiveTree* tree = atCreate();
+    bool success = (mapped || chunk) && dest && tree && output;
+    if (!success)
+        fprintf(stderr, "Could not allocate the stream buffers.\n");
+
+    TextHeader header = {TEXT_ADAPTIVE, TEXT_UNKNOWN_SIZE, TEXT_UNKNOWN_SIZE};
+    unsigned char headerBytes[TEXT_HEADER_SIZE];
+    size_t counts[ASCII_SIZE];
+    memset(counts, 0, sizeof(counts));
+    long headerOffset = success ? ftell(output) : -1;
+
+    BitWriter writer;
+    if (success) {
+        writeTextHeader(&header, headerBytes);
+        success = fwrite(headerBytes, 1, TEXT_HEADER_SIZE, output) ==
+                  TEXT_HEADER_SIZE;
+        biseWriterInit(&writer, dest);
+    }
+
+    if (mapped) {
+        const char* data = (const char*) mfData(file);
+        size_t size = mfSize(file);
+        for (size_t offset = 0; success && offset < size;
+             offset += STREAM_CHUNK_SIZE) {
+            size_t chunk_size = size - offset < STREAM_CHUNK_SIZE ?
+                                size - offset : STREAM_CHUNK_SIZE;
+            countCharacters(data + offset, chunk_size, counts);
+            success = atEncode(tree, data + offset, chunk_size, &writer) &&
+                      biseWriterEmit(&writer, output);
+        }
+    }
+
+    size_t read_size;
+    while (success && !mapped &&
+           (read_size = fread(chunk, sizeof(char), STREAM_CHUNK_SIZE,
+                              input)) > 0) {
+        countCharacters(chunk, read_size, counts);
+        success = atEncode(tree, chunk, read_size, &writer) &&
+                  biseWriterEmit(&writer, output);
+    }
+
+    success = success && atEncodeEnd(tree, &writer) &&
+              biseWriterEmit(&writer, output);
+    long endOffset = success && headerOffset >= 0 ? ftell(output) : -1;
+    if (endOffset >= 0) {
+        header.n_chars = 0;
+        for (size_t c = 0; c < ASCII_SIZE; c++)
+            header.n_chars += counts[c];
+        header.n_bits = 8 * (size_t) (endOffset - headerOffset -
+                                      TEXT_HEADER_SIZE) + writer.n_buffered;
+    }
+
+    if (success) {
+        // Padding up to a whole byte
+        success = biseWriteBits(&writer, 0, (8 - writer.n_buffered % 8) % 8)
+                  && biseWriterEmit(&writer, output);
+    }
+    if (success && endOffset >= 0) {
+        writeTextHeader(&header, headerBytes);
+        success = fseek(output, headerOffset, SEEK_SET) == 0 &&
+                  fwrite(headerBytes, 1, TEXT_HEADER_SIZE, output) ==
+                  TEXT_HEADER_SIZE;
+    }
+    if (!success || (input && ferror(input)))
+        fprintf(stderr, "Could not encode text from file '%s'.\n",
+                inputPath);
+
+    atFree(tree);
+    free(chunk);
+    biseFree(dest);
+    mfClose(file);
+    if (input && input != stdin)
+        fclose(input);
+    if (output && output != stdout)
+        fclose(output);
+    return success;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Decode the given binary input encoded by `onePassEncode` chunk by chunk,
+ * writing the decoded characters of each chunk as soon as they are decoded.
+ * Only a chunk of the input and of the output are held in memory.
+ *
+ * PARAMETERS
+ * inputPath    The path to the binary input file, or "-" for standard input
+ * outputPath   The path to the output file, or NULL to print on standard
+ *              output
+ * mapped       Whether to map the input file in memory and decode its pages
+ *              directly rather than reading it in a buffer
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool onePassDecode(const char* inputPath, const char* outputPath,
+                          bool mapped) {
+    FILE* input = NULL;
+    MappedFile* file = NULL;
+    if (mapped)
+        file = mfOpen(inputPath);
+    else
+        input = openStreamInput(inputPath);
+    if (!input && !file) {
+        fprintf(stderr, "Could not open file '%s'.\n", inputPath);
+        return false;
+    }
+    FILE* output = (!outputPath) ? stdout : fopen(outputPath, "wb");
+
+    // A mapped file is decoded in place, as a single chunk
+    unsigned char* buffer = mapped ? NULL : malloc(STREAM_CHUNK_SIZE);
+    const unsigned char* bytes = mapped ? mfData(file) : buffer;
+    char* decoded = malloc(STREAM_CHUNK_SIZE);
+    AdaptiveTree* tree = atCreate();
+    bool success = (mapped || buffer) && decoded && tree && output;
+
+    // Bits dropped from the buffer so far
+    size_t n_bytes = mapped ? mfSize(file) : 0, position = 0, dropped = 0;
+    size_t n_chars = 0;
+    TextHeader header;
+    bool endOfInput = mapped, readHeader = false, reachedEnd = false;
+    bool reported = false;
+    while (success && !reachedEnd) {
+        // Keep the unread bytes and fill the rest of the buffer
+        if (!endOfInput) {
+            size_t first = position / 8;
+            memmove(buffer, buffer + first, n_bytes - first);
+            n_bytes -= first;
+            position -= 8 * first;
+            dropped += 8 * first;
+            size_t read_size = fread(buffer + n_bytes, sizeof(unsigned char),
+                                     STREAM_CHUNK_SIZE - n_bytes, input);
+            n_bytes += read_size;
+            endOfInput = n_bytes < STREAM_CHUNK_SIZE;
+        }
+
+        if (!readHeader) { // The whole header fits in the first chunk
+            success = readTextHeader(bytes, n_bytes, &header);
+            reported = success && header.flags != TEXT_ADAPTIVE;
+            if (reported) {
+                printMissingOption(inputPath, header.flags);
+                success = false;
+            }
+            position = 8 * TEXT_HEADER_SIZE;
+            readHeader = true;
+            if (!success)
+                break;
+        }
+
+        BitReader reader;
+        biseReaderInitBuffer(&reader, bytes, 8 * n_bytes, position);
+
+        // Only decode the codes which are entirely in the buffer
+        size_t limit = 8 * n_bytes;
+        if (!endOfInput)
+            limit = limit > AT_MAX_CODE_LENGTH ?
+                    limit - AT_MAX_CODE_LENGTH : 0;
+        size_t n_decoded = STREAM_CHUNK_SIZE;
+        while (success && !reachedEnd && n_decoded == STREAM_CHUNK_SIZE) {
+            success = atDecode(tree, &reader, limit, decoded,
+                               STREAM_CHUNK_SIZE, &n_decoded, &reachedEnd) &&
+                      fwrite(decoded, sizeof(char), n_decoded, output)
+                      == n_decoded;
+            n_chars += n_decoded;
+        }
+        position = biseReaderTell(&reader);
+
+        // Truncated input
+        success = success && (reachedEnd || !endOfInput);
+    }
+
+    // The codes must end where the header says, if it says anything
+    if (success && header.n_chars != TEXT_UNKNOWN_SIZE)
+        success = n_chars == header.n_chars &&
+                  dropped + position == 8 * TEXT_HEADER_SIZE + header.n_bits;
+    if ((!success && !reported) || (input && ferror(input)))
+        fprintf(stderr, "Could not decode binary sequence from file '%s'.\n",
+                inputPath);
+
+    atFree(tree);
+    free(buffer);
+    free(decoded);
+    mfClose(file);
+    if (input && input != stdin)
+        fclose(input);
+    if (output && output != stdout)
+        fclose(output);
+    return success;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Return the number of threads to use by default, one per online processor.
+ *
+ * RETURN
+ * n_threads    The number of threads
+ * ------------------------------------------------------------------------- */
+static size_t defaultThreadCount(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_processors > 0)
+        return (size_t) n_processors;
+#endif
+    return 1;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Return the value of the command line option at `*i`, moving `*i` to it.
+ *
+ * PARAMETERS
+ * argc         The number of command line arguments
+ * argv         The command line arguments
+ * i            The index of the option, set to the index of its value
+ *
+ * RETURN
+ * value        The argument following the option, or NULL if the option is
+ *              the last argument
+ * ------------------------------------------------------------------------- */
+static const char* optionValue(int argc, char** argv, int* i) {
+    if (*i + 1 >= argc)
+        return NULL;
+    return argv[++*i];
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Parse the decimal number at the start of the value of an option.
+ *
+ * PARAMETERS
+ * text         The value of the option, or NULL if it is missing
+ * end          Where to store the first character after the number, or NULL
+ *              if the number must be the whole value
+ * value        Where to store the number
+ *
+ * RETURN
+ * success      true if the value starts with a number (or is one, without
+ *              `end`) which fits in a size_t, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool parseNumber(const char* text, const char** end, size_t* value) {
+    if (!text || !isdigit((unsigned char) text[0]))
+        return false;
+
+    char* stop;
+    errno = 0;
+    unsigned long long number = strtoull(text, &stop, 10);
+    if (errno == ERANGE || number > SIZE_MAX || (!end && *stop != '\0'))
+        return false;
+    *value = (size_t) number;
+    if (end)
+        *end = stop;
+    return true;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Encode the given ascii input file into independent blocks, in parallel,
+ * and save the result in `outputPath`.
+ *
+ * PARAMETERS
+ * inputPath    The path to the ascii input file
+ * trees        The coding trees each block chooses from
+ * n_trees      The number of trees
+ * outputPath   The path to the output file, or NULL to print on standard
+ *              output
+ * options      The block size, number of threads and flags
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool blockEncode(const char* inputPath, const CodingTree* const* trees,
+                        size_t n_trees, const char* outputPath,
+                        const BlockOptions* options) {
+    MappedFile* file = mfOpen(inputPath);
+    if (!file) {
+        fprintf(stderr, "Could not open file '%s'.\n", inputPath);
+        return false;
+    }
+    FILE* output = (!outputPath) ? stdout : fopen(outputPath, "wb");
+
+    bool success = output &&
+                   encodeBlocks((const char*) mfData(file), mfSize(file),
+                                trees, n_trees, options, output);
+    if (!success)
+        fprintf(stderr, "Could not encode text from file '%s'.\n",
+                inputPath);
+
+    mfClose(file);
+    if (output && output != stdout)
+        fclose(output);
+    return success;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Decode the given file encoded by blocks, in parallel, and save the result
+ * in `outputPath`.
+ *
+ * PARAMETERS
+ * inputPath    The path to the binary input file
+ * outputPath   The path to the output file, or NULL to print on standard
+ *              output
+ * options      The number of threads decoding the blocks
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool blockDecode(const char* inputPath, const char* outputPath,
+                        const BlockOptions* options) {
+    MappedFile* file = mfOpen(inputPath);
+    if (!file) {
+        fprintf(stderr, "Could not open file '%s'.\n", inputPath);
+        return false;
+    }
+    FILE* output = (!outputPath) ? stdout : fopen(outputPath, "wb");
+
+    bool success = output &&
+                   decodeBlocks(mfData(file), mfSize(file), options, output);
+    if (!success)
+        fprintf(stderr, "Could not decode blocks from file '%s'.\n",
+                inputPath);
+
+    mfClose(file);
+    if (output && output != stdout)
+        fclose(output);
+    return success;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Build the coding tree of a frequency CSV.
+ *
+ * PARAMETERS
+ * csvPath      The path to the CSV file
+ * maxLength    The maximum code length, 0 for the Huffman code
+ *
+ * RETURN
+ * tree         The coding tree, or NULL in case of error
+ * ------------------------------------------------------------------------- */
+static CodingTree* csvTree(const char* csvPath, size_t maxLength) {
+    double* frequencies = fqFromCsv(csvPath);
+    if (!frequencies)
+        return NULL;
+
+    CodingTree* tree = maxLength ? ctHuffmanLimited(frequencies, maxLength)
+                                 : ctHuffman(frequencies);
+    free(frequencies);
+    return tree;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * Build the coding and decoding tables of a tree and store them in the
+ * cache, for the next runs with the same CSV.
+ *
+ * PARAMETERS
+ * cacheDir     The cache directory
+ * csvPath      The path to the CSV file the tree was built from
+ * maxLength    The maximum code length of the tree, 0 for the Huffman code
+ * tree         The coding tree
+ *
+ * RETURN
+ * success      true in case of succes, false otherwise
+ * ------------------------------------------------------------------------- */
+static bool cacheTables(const char* cacheDir, const char* csvPath,
+                        size_t maxLength, const CodingTree* tree) {
+    PackedCode codes[ASCII_SIZE];
+    DecodingTable* table = ctPackedCodingTable(tree, codes) ?
+                           dtCreate(codes) : NULL;
+    bool success = table && tcStore(cacheDir, csvPath, maxLength, codes,
+                                    table);
+    dtFree(table);
+    return success;
+}
+
+
 /* ------------------------------------------------------------------------- *
  * NAME
  * huffman
  *
  * SYNOPSIS
- * huffman [-e] [-d] [-f] [-o outputPath] textPath csvPath
+ * huffman [-e] [-d] [-c] [-a] [-p] [-1] [-s] [-m] [-b] [-i] [-x]
+ *         [-j threads] [-n blockKiB] [-r first[:length]] [-g line[:count]]
+ *         [-l maxLength] [-t code]
+ *         [-k cacheDir] [-o outputPath] textPath [csvPath...]
  *
  * DESCRIPTION
  * Encode (resp. decode) a given plain (resp. binary) text with the optimal
@@ -292,14 +1065,76 @@ static bool readAndEncode(const char* inputpath, const CodingTree* tree,
  *
  * -e               Encode the text (optional). By default, the text is decoded
  * -d               Debug flag (optional). Runs the code in debug mode.
- * -f <eofChar>     Ascii integer code for the end of file character (optional).
- *                  By default, using File Separator (FS, value 28) ASCII
- *                  character.
+ * -c               Canonical code (optional). When encoding, the code lengths
+ *                  are written in front of the encoded text. When decoding,
+ *                  the code is read from the file and no CSV is needed. The
+ *                  header of an encoded file tells which code it needs, so
+ *                  that -c, -a and -1 files are decoded with or without
+ *                  their option, and -p ones are reported.
+ * -a               Adaptive (optional). When encoding, the frequencies are
+ *                  counted in the text itself instead of being read from a
+ *                  CSV, and the code is written in the file as with -c. When
+ *                  decoding, same as -c. Not available on the standard input.
+ * -p               One pass (optional). The text is encoded with an adaptive
+ *                  Huffman code, updated after each character in the same
+ *                  way by the encoder and the decoder, so that no CSV is
+ *                  needed and the text is read only once. The text is
+ *                  (de)coded as with -s, also from and to pipes. Not
+ *                  available with -c, -a, -b, -l, -t or -k.
+ * -1               Order 1 (optional). Each character is encoded with a code
+ *                  depending on the character before it, built from the
+ *                  pairs of characters counted in the text. The codes are
+ *                  written in the file, so no CSV is needed. Not available
+ *                  with -c, -a, -p, -s, -m, -b, -l, -t or -k, nor on the
+ *                  standard input.
+ * -s               Stream (optional). The input is read, (de)coded and
+ *                  written chunk by chunk, so that only a chunk is held in
+ *                  memory. textPath can then be "-" for the standard input.
+ * -m               Map the input file in memory (optional). The input file is
+ *                  (de)coded directly from its mapped pages, without being
+ *                  copied, and the output is written chunk by chunk.
+ * -b               Blocks (optional). The text is split into blocks (of 1 MiB
+ *                  by default) encoded independently and in parallel, with
+ *                  the canonical code. No CSV is needed to decode.
+ * -i               Interleaved (optional, with -b when encoding). Each block
+ *                  is encoded as 4 streams decoded together, which keeps
+ *                  several lookups in flight at once.
+ * -x               Checksums (optional, with -b when encoding). The CRC-32C
+ *                  of each block is stored in the index, and checked when the
+ *                  block is decoded.
+ * -j <threads>     Number of threads used with -b (optional). By default,
+ *                  one per processor.
+ * -n <blockKiB>    Size of the blocks in KiB, with -b when encoding
+ *                  (optional). By default, 1024. Smaller blocks make -r
+ *                  decode less around the range.
+ * -r <first[:len]> Range (optional, with -b when decoding). Only the `len`
+ *                  characters of the decoded text from the `first` one (all
+ *                  the following ones if `len` is omitted) are written, and
+ *                  only the blocks they overlap are read and decoded.
+ * -g <line[:n]>    Lines (optional, with -b when decoding). Same as -r, for
+ *                  the `n` lines from the line number `line` (from 1).
+ * -l <maxLength>   Maximum length of a code, between 7 and 57 (optional). The
+ *                  optimal code under this limit is used instead of the
+ *                  Huffman code, e.g. 11 so that any code is decoded with a
+ *                  single table lookup. Must be given again to decode without
+ *                  -c, -a or -b.
+ * -t <code>        Built-in code (optional). The code generated at build time
+ *                  from a CSV under this name is used, instead of reading the
+ *                  CSV and building the tree. The text is (de)coded as with
+ *                  -s. Not available with -c, -a, -b or -l.
+ * -k <cacheDir>    Table cache (optional). The tables built from the CSV are
+ *                  stored in this existing directory, and mapped from it by
+ *                  the next runs with the same CSV instead of being built
+ *                  again. The text is (de)coded as with -s. Not available
+ *                  with -c, -a, -b or -t.
  * -o <outptPath>   Specify the output path (optional). By default, the text
  *                  is printed on the standard output
  * textPath         The path to the plain/binary text to encode/decode
  * csvPath          The path to the CSV file containing the frequency of the
- *                  ascii characters for a given language
+ *                  ascii characters for a given language (optional when
+ *                  decoding with -c, and with -t). When encoding with -b,
+ *                  several CSV files can be given: each block is encoded
+ *                  with the code of the one it is the shortest with.
  *
  * RETURN
  * EXIT_SUCCESS|EXIT_FAILURE
@@ -307,63 +1142,246 @@ static bool readAndEncode(const char* inputpath, const CodingTree* tree,
 int main(int argc, char** argv) {
 
     /* ---------------------- PARSING COMMAND LINE ARGS --------------------- */
-    if (argc < 2 || argc > 7) {
-        fprintf(stderr, "USAGE: %s [-e] [-d] [-f <eofChar>] [-o <outptPath>] "
-                        "<textPath> <csvPath>\n", argv[0]);
+    if (argc < 2 || argc > 26 + BLOCK_MAX_TABLES) {
+        fprintf(stderr, "USAGE: %s [-e] [-d] [-c] [-a] [-p] [-1] [-s] [-m] "
+                        "[-b] [-i] [-x] [-j <threads>] [-n <blockKiB>] "
+                        "[-r <first[:length]>] [-g <line[:count]>] "
+                        "[-l <maxLength>] [-t <code>] "
+                        "[-k <cacheDir>] [-o <outptPath>] "
+                        "<textPath> [<csvPath>...]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
     bool decode = true;
     bool debug = false;
-    unsigned char eofChar = (char) 28;
+    bool canonical = false;
+    bool adaptive = false;
+    bool onePass = false;
+    bool context = false;
+    bool stream = false;
+    bool mapped = false;
+    bool blocks = false;
+    BlockOptions blockOptions = {BLOCK_SIZE, defaultThreadCount(), 0, 0,
+                                 SIZE_MAX, false};
+    bool range = false;
+    size_t maxLength = 0;
+    const char* builtinName = NULL;
+    const char* cacheDir = NULL;
     const char* outputPath = NULL;
     const char* textPath = NULL;
-    const char* csvPath = NULL;
+    const char* csvPaths[BLOCK_MAX_TABLES];
+    size_t n_csv = 0;
+    // Whether every option has a valid value
+    bool validValues = true;
 
     int i = 0;
-    while (++i < argc) {
+    while (validValues && ++i < argc) {
         if (strcmp(argv[i], "-e") == 0) {
             decode = false;
         } else if (strcmp(argv[i], "-d") == 0) {
             debug = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            canonical = true;
+        } else if (strcmp(argv[i], "-a") == 0) {
+            adaptive = true;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            onePass = true;
+        } else if (strcmp(argv[i], "-1") == 0) {
+            context = true;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            stream = true;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            mapped = true;
+        } else if (strcmp(argv[i], "-b") == 0) {
+            blocks = true;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            validValues = parseNumber(optionValue(argc, argv, &i), NULL,
+                                      &blockOptions.n_threads) &&
+                          blockOptions.n_threads > 0;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            blockOptions.flags |= BLOCK_INTERLEAVED;
+        } else if (strcmp(argv[i], "-n") == 0) {
+            // The block size is stored on 4 bytes
+            size_t kib;
+            validValues = parseNumber(optionValue(argc, argv, &i), NULL,
+                                      &kib) &&
+                          kib > 0 && kib <= UINT32_MAX / 1024;
+            blockOptions.blockSize = 1024 * kib;
+        } else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "-g") == 0) {
+            const char* end = NULL;
+            range = true;
+            blockOptions.lines = strcmp(argv[i], "-g") == 0;
+            validValues = parseNumber(optionValue(argc, argv, &i), &end,
+                                      &blockOptions.first) &&
+                          (*end == '\0' ||
+                           (*end == ':' &&
+                            parseNumber(end + 1, NULL,
+                                        &blockOptions.length)));
+            // Lines are numbered from 1 on the command line
+            if (blockOptions.lines && blockOptions.first > 0)
+                blockOptions.first--;
+        } else if (strcmp(argv[i], "-x") == 0) {
+            blockOptions.flags |= BLOCK_CHECKSUM;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            validValues = parseNumber(optionValue(argc, argv, &i), NULL,
+                                      &maxLength) &&
+                          maxLength > 0;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            builtinName = optionValue(argc, argv, &i);
+            validValues = builtinName != NULL;
+        } else if (strcmp(argv[i], "-k") == 0) {
+            cacheDir = optionValue(argc, argv, &i);
+            validValues = cacheDir != NULL;
         } else if (strcmp(argv[i], "-o") == 0) {
-            outputPath = argv[++i];
-        } else if (strcmp(argv[i], "-f") == 0) {
-            eofChar = (unsigned char) strtol(argv[++i], NULL, 10);
+            outputPath = optionValue(argc, argv, &i);
+            validValues = outputPath != NULL;
         } else if (!textPath) {
             textPath = argv[i];
-        } else
-            csvPath = argv[i];
+        } else {
+            if (n_csv < BLOCK_MAX_TABLES)
+                csvPaths[n_csv] = argv[i];
+            n_csv++;
+        }
     }
+    const char* csvPath = n_csv > 0 ? csvPaths[0] : NULL;
 
-    if (!textPath || !csvPath) {
-        fprintf(stderr, "USAGE: %s [-e] [-d] [-f <eofChar>] [-o <outptPath>]"
-                        " <textPath> <csvPath>\n", argv[0]);
+    // Adaptive codes are always written in the file.
+    canonical = canonical || adaptive;
+    bool builtinCode = builtinName != NULL;
+    // When decoding, the header tells whether the code is in the file
+    bool needsTree = !builtinCode && !onePass && !context &&
+                     (!decode || (!canonical && !blocks && csvPath));
+    bool needsCsv = needsTree && !adaptive;
+    if (!validValues || !textPath || (needsCsv && !csvPath) ||
+        (adaptive && needsTree && strcmp(textPath, "-") == 0) ||
+        (builtinCode && (canonical || blocks || maxLength)) ||
+        (cacheDir && (canonical || blocks || builtinCode || !csvPath)) ||
+        (range && !(blocks && decode)) ||
+        (onePass && (canonical || blocks || maxLength || builtinCode ||
+                     cacheDir)) ||
+        (n_csv > 1 && (!blocks || decode || adaptive)) ||
+        n_csv > BLOCK_MAX_TABLES ||
+        (context && (canonical || onePass || stream || mapped || blocks ||
+                     maxLength || builtinCode || cacheDir))) {
+        fprintf(stderr, "USAGE: %s [-e] [-d] [-c] [-a] [-p] [-1] [-s] [-m] "
+                        "[-b] [-i] [-x] [-j <threads>] [-n <blockKiB>] "
+                        "[-r <first[:length]>] [-g <line[:count]>] "
+                        "[-l <maxLength>] [-t <code>] "
+                        "[-k <cacheDir>] [-o <outptPath>] "
+                        "<textPath> [<csvPath>...]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
 
+    // Tables built in or cached, used instead of the tree
+    const PackedCode* prebuiltCodes = NULL;
+    const DecodingTable* prebuiltTable = NULL;
+    if (builtinCode) {
+        const BuiltinCode* builtin = bcFind(builtinName);
+        if (!builtin) {
+            fprintf(stderr, "Unknown built-in code '%s'. Available codes:",
+                    builtinName);
+            for (size_t c = 0; c < bcCount(); c++)
+                fprintf(stderr, " %s", bcGet(c)->name);
+            fprintf(stderr, "\n");
+            return EXIT_FAILURE;
+        }
+        prebuiltCodes = builtin->codes;
+        prebuiltTable = builtin->table;
+    }
+
+    TableCache* cache = cacheDir ? tcLoad(cacheDir, csvPath, maxLength) : NULL;
+    if (cache) {
+        prebuiltCodes = tcCodes(cache);
+        prebuiltTable = tcTable(cache);
+        needsTree = false;
+    }
+
+
     /* ---------------------------- BUILDING TREE --------------------------- */
-    double* frequencies = csvToFrequencies(csvPath);
-    if (!frequencies) {
-        fprintf(stderr, "Could not parse CSV. Either the format is not valid "
-                        "or there was a memory error. Aborting.\n");
-        return EXIT_FAILURE;
+    double* frequencies = NULL;
+    CodingTree* huffmanTree = NULL;
+    if (needsTree && adaptive) {
+        frequencies = inputToFrequencies(textPath);
+        if (!frequencies) {
+            fprintf(stderr, "Could not count the characters of '%s'. "
+                            "Aborting.\n", textPath);
+            return EXIT_FAILURE;
+        }
+    } else if (needsTree) {
+        frequencies = fqFromCsv(csvPath);
+        if (!frequencies) {
+            fprintf(stderr, "Could not parse CSV. Either the format is not "
+                            "valid or there was a memory error. Aborting.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (needsTree) {
+        if (maxLength)
+            huffmanTree = ctHuffmanLimited(frequencies, maxLength);
+        else if (adaptive) // Characters absent from the text need no code
+            huffmanTree = ctHuffmanLinear(frequencies, true);
+        else
+            huffmanTree = ctHuffman(frequencies);
+        if (!huffmanTree) {
+            fprintf(stderr, "Could not build the coding tree (with -l, the "
+                            "maximum code length must be between 7 and "
+                            "57). Aborting.\n");
+            free(frequencies);
+            return EXIT_FAILURE;
+        }
     }
 
-    CodingTree* huffmanTree = ctHuffman(frequencies);
+    if (cacheDir && !cache &&
+        !cacheTables(cacheDir, csvPath, maxLength, huffmanTree))
+        fprintf(stderr, "Could not store the tables in '%s'.\n", cacheDir);
+
+    // Other candidate codes of the blocks, one per additional CSV
+    const CodingTree* trees[BLOCK_MAX_TABLES] = {huffmanTree};
+    size_t n_trees = 1;
+    for (; n_trees < n_csv; n_trees++) {
+        trees[n_trees] = csvTree(csvPaths[n_trees], maxLength);
+        if (!trees[n_trees]) {
+            fprintf(stderr, "Could not build the coding tree of '%s'. "
+                            "Aborting.\n", csvPaths[n_trees]);
+            for (size_t t = 0; t < n_trees; t++)
+                ctFree((CodingTree*) trees[t]);
+            free(frequencies);
+            return EXIT_FAILURE;
+        }
+    }
 
     /* ----------------------------- (DE)CODING ----------------------------- */
     bool success;
-    if (decode)
-        success = readAndDecode(textPath, huffmanTree, outputPath, eofChar);
+    if (onePass && decode)
+        success = onePassDecode(textPath, outputPath, mapped);
+    else if (onePass)
+        success = onePassEncode(textPath, outputPath, mapped);
+    else if (blocks && decode)
+        success = blockDecode(textPath, outputPath, &blockOptions);
+    else if (blocks)
+        success = blockEncode(textPath, trees, n_trees, outputPath,
+                              &blockOptions);
+    else if ((stream || mapped || builtinCode || cacheDir) && decode)
+        success = streamDecode(textPath, huffmanTree, prebuiltTable,
+                               outputPath, mapped);
+    else if (stream || mapped || builtinCode || cacheDir)
+        success = streamEncode(textPath, huffmanTree, prebuiltCodes,
+                               outputPath, canonical, mapped);
+    else if (decode)
+        success = readAndDecode(textPath, huffmanTree, outputPath);
     else
         success = readAndEncode(textPath, huffmanTree, outputPath, debug,
-                                eofChar);
+                                canonical, context);
 
 
     free(frequencies);
-    ctFree(huffmanTree);
+    if (huffmanTree)
+        ctFree(huffmanTree);
+    for (size_t t = 1; t < n_trees; t++)
+        ctFree((CodingTree*) trees[t]);
+    tcClose(cache);
     if (!success) {
         fprintf(stderr, "Some error occured. Aborting.\n");
         return EXIT_FAILURE;